@@ -0,0 +1,517 @@
+/*
+  ==============================================================================
+
+    CompressorBenchmark.cpp
+    Created: 17 Oct 2026 5:02:37pm
+    Author:  marks
+
+    Microbenchmark for the Compressor DSP. Runs processBuffer over a matrix of
+    block sizes, sample rates, parameter presets and test signals, and prints
+    one CSV row per combination so results can be diffed between builds. the
+    matrix runs once in single and once in double precision.
+
+    usage: CompressorBenchmark [--seconds s] [--repeats n] [--quick] [--decimation n]
+                               [--channels n] [--link peak|mean|rms|unlinked] [--stems n]
+                               [--oversampling n] [--detector] [--rmswindow s] [--bank n]
+
+    --stems n times the split processing instead: computeGain on the signal as
+    the key, and applyGain of that curve to n targets of the same width.
+
+    --oversampling n runs the compressor n times oversampled, through a single
+    band multiband engine. with --detector only the detector is oversampled.
+
+    --rmswindow s switches the detector to RMS over a window of s seconds.
+
+    --bank n times n stereo instances, first as n Compressors run one after
+    the other, then through CompressorBank with 4, 8 and 16 lanes. the mode
+    is exact-bankn or lanesL-bankn, ns_per_sample is per frame of one instance
+    and an extra column gives how far the bank output strays from the
+    Compressors, in dB of full scale, -inf when they match. the other options
+    do not apply.
+
+  ==============================================================================
+*/
+
+#include "../Source/MultibandCompressor.h"
+#include "../Source/CompressorBank.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+ #include <intrin.h>
+ #define BENCH_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+ #include <x86intrin.h>
+ #define BENCH_HAS_TSC 1
+#else
+ #define BENCH_HAS_TSC 0
+#endif
+
+static inline unsigned long long readcyclecounter()
+{
+#if BENCH_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Preset
+{
+    const char* name;
+    float pregain, threshold, knee, ratio, attack, release, predelay, postgain, wet;
+};
+
+static const Preset presets[] = {
+    // name            pregain thresh knee   ratio  attack  release predelay postgain wet
+    { "noknee",        0.0f, -24.0f,  0.0f, 12.0f, 0.003f, 0.250f, 0.006f, 0.0f, 1.0f },
+    { "hardknee",      0.0f, -24.0f,  3.0f, 12.0f, 0.003f, 0.250f, 0.006f, 0.0f, 1.0f },
+    { "wideknee",      0.0f, -24.0f, 30.0f,  4.0f, 0.003f, 0.250f, 0.006f, 0.0f, 1.0f },
+    { "longpredelay",  0.0f, -12.0f, 30.0f, 12.0f, 0.003f, 0.250f, 0.100f, 0.0f, 1.0f },
+};
+
+static const char* signalnames[] = { "silence", "sine", "noise", "transients" };
+
+static void fillSignal(int type, int samplerate, std::vector<float>& left, std::vector<float>& right)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+    for (size_t i = 0; i < left.size(); i++)
+    {
+        float t = (float)i / (float)samplerate;
+        float l = 0.0f, r = 0.0f;
+        switch (type)
+        {
+        case 1: // 1 kHz sine at -6 dBFS
+            l = r = 0.5f * sin(2.0f * (float)M_PI * 1000.0f * t);
+            break;
+        case 2: // white noise at about -6 dBFS peak
+            l = 0.5f * noise(rng);
+            r = 0.5f * noise(rng);
+            break;
+        case 3: { // full scale noise bursts every 100 ms, decaying over about 20 ms
+            float phase = fmod(t, 0.1f);
+            float env = exp(-phase * 200.0f);
+            l = env * noise(rng);
+            r = env * noise(rng);
+            break;
+        }
+        default: // silence
+            break;
+        }
+        left[i] = l;
+        right[i] = r;
+    }
+}
+
+template <typename Sample>
+static void configure(BasicCompressor<Sample>& comp, const Preset& p, int samplerate, bool fastmath, int decimation,
+    int numchannels, int link, float rmswindow)
+{
+    comp.prepare(samplerate, numchannels);
+    comp.set_linearpregain(p.pregain);
+    comp.set_linearthreshold(p.threshold);
+    comp.set_slope(1.0f / p.ratio);
+    comp.calculate_knee(p.knee);
+    comp.set_attack(samplerate, p.attack);
+    comp.set_release(samplerate, p.release);
+    comp.set_delaybufsize(samplerate, p.predelay);
+    comp.set_postgain(p.postgain);
+    comp.set_wetlevel(p.wet);
+    comp.set_fastmath(fastmath);
+    comp.set_decimation(decimation);
+    comp.set_link((typename BasicCompressor<Sample>::LinkMode)link);
+    comp.set_rmswindow(samplerate, rmswindow);
+}
+
+// times repeats runs over the whole signal in blocks of blocksize, per sample. channels past the
+// first two repeat the left and right signals. with stems the split processing is timed, see above
+template <typename Sample>
+static void measure(const Preset& preset, int samplerate, bool fastmath, int decimation, int numchannels, int link,
+    int stems, int oversampling, bool detectoronly, float rmswindow, int blocksize, const std::vector<float>& left,
+    const std::vector<float>& right, std::vector<double>& nspersample, double& cycles)
+{
+    int numsamples = (int)left.size();
+    std::vector<Sample> inL(left.begin(), left.end()), inR(right.begin(), right.end());
+    std::vector<std::vector<Sample>> outs((size_t)numchannels, std::vector<Sample>((size_t)numsamples));
+    std::vector<Sample> gain(stems > 0 ? (size_t)numsamples : 0);
+    cycles = 0.0;
+    for (size_t r = 0; r < nspersample.size(); r++)
+    {
+        // a fresh instance per repeat so every run starts from the same state
+        auto comp = std::make_unique<BasicCompressor<Sample>>();
+        configure(*comp, preset, samplerate, fastmath, decimation, numchannels, link, rmswindow);
+        comp->set_detectoroversampling(detectoronly ? oversampling : 1);
+        // the whole compressor oversampled is band 0 of an engine that resamples around it
+        std::unique_ptr<BasicMultibandCompressor<Sample>> engine;
+        if (!detectoronly && oversampling > 1)
+        {
+            engine = std::make_unique<BasicMultibandCompressor<Sample>>();
+            engine->prepare(samplerate, numchannels, SF_COMPRESSOR_MAXPREDELAY, oversampling);
+            configure(engine->getBand(0), preset, samplerate * oversampling, fastmath, decimation, numchannels, link,
+                rmswindow);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long startcycles = readcyclecounter();
+        for (int pos = 0; pos < numsamples; pos += blocksize)
+        {
+            int len = numsamples - pos < blocksize ? numsamples - pos : blocksize;
+            const Sample* inptrs[SF_COMPRESSOR_MAXCHANNELS];
+            Sample* outptrs[SF_COMPRESSOR_MAXCHANNELS];
+            for (int ch = 0; ch < numchannels; ch++)
+            {
+                inptrs[ch] = ((ch & 1) ? inR.data() : inL.data()) + pos;
+                outptrs[ch] = outs[(size_t)ch].data() + pos;
+            }
+            if (stems > 0)
+            {
+                // the targets all write the same output, only the time matters
+                comp->computeGain(inptrs, numchannels, gain.data() + pos, len);
+                for (int s = 0; s < stems; s++)
+                    BasicCompressor<Sample>::applyGain(gain.data() + pos, inptrs, outptrs, numchannels, len);
+            }
+            else if (engine)
+                engine->processBuffer(inptrs, outptrs, numchannels, len);
+            else
+                comp->processBuffer(inptrs, outptrs, numchannels, len);
+        }
+        unsigned long long endcycles = readcyclecounter();
+        auto end = std::chrono::steady_clock::now();
+
+        nspersample[r] = std::chrono::duration<double, std::nano>(end - start).count() / numsamples;
+        cycles += (double)(endcycles - startcycles) / numsamples;
+    }
+}
+
+// one timed pass over every instance in blocks of blocksize, in place. process gets the left and
+// right pointers of the block of every instance. returns the time per instance frame
+template <typename Process>
+static double timeInstances(int blocksize, std::vector<std::vector<float>>& left,
+    std::vector<std::vector<float>>& right, double& cycles, Process process)
+{
+    size_t instances = left.size();
+    int numsamples = (int)left[0].size();
+    std::vector<float*> lptrs(instances), rptrs(instances);
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned long long startcycles = readcyclecounter();
+    for (int pos = 0; pos < numsamples; pos += blocksize)
+    {
+        int len = numsamples - pos < blocksize ? numsamples - pos : blocksize;
+        for (size_t k = 0; k < instances; k++)
+        {
+            lptrs[k] = left[k].data() + pos;
+            rptrs[k] = right[k].data() + pos;
+        }
+        process(lptrs.data(), rptrs.data(), len);
+    }
+    unsigned long long endcycles = readcyclecounter();
+    auto end = std::chrono::steady_clock::now();
+
+    cycles += (double)(endcycles - startcycles) / ((double)numsamples * (double)instances);
+    return std::chrono::duration<double, std::nano>(end - start).count() / ((double)numsamples * (double)instances);
+}
+
+// the compressors one after the other
+static double runInstances(std::vector<std::unique_ptr<Compressor>>& comps, int blocksize,
+    std::vector<std::vector<float>>& left, std::vector<std::vector<float>>& right, double& cycles)
+{
+    return timeInstances(blocksize, left, right, cycles, [&](float** lptrs, float** rptrs, int len)
+    {
+        for (size_t k = 0; k < comps.size(); k++)
+        {
+            float* ptrs[2] = { lptrs[k], rptrs[k] };
+            comps[k]->processBuffer(ptrs, ptrs, 2, len);
+        }
+    });
+}
+
+// the compressors copied into a bank, which is set up before the clock starts
+template <int Lanes>
+static double runBank(std::vector<std::unique_ptr<Compressor>>& comps, int samplerate, int blocksize,
+    std::vector<std::vector<float>>& left, std::vector<std::vector<float>>& right, double& cycles)
+{
+    CompressorBank<Lanes> bank((int)comps.size(), samplerate);
+    for (size_t k = 0; k < comps.size(); k++)
+        bank.setInstance((int)k, *comps[k]);
+    return timeInstances(blocksize, left, right, cycles, [&](float** lptrs, float** rptrs, int len)
+    {
+        bank.processBuffers(lptrs, rptrs, len);
+    });
+}
+
+// times instances copies of the preset, as Compressors for lanes 0 and through the bank otherwise. every
+// instance starts the signal at its own offset, so the lanes do not all take the same path. deviation
+// receives the largest difference of the bank output from the Compressors, in dB
+static void measureBank(const Preset& preset, int samplerate, int lanes, int instances, int blocksize,
+    const std::vector<float>& left, const std::vector<float>& right, std::vector<double>& nspersample,
+    double& cycles, double& deviation)
+{
+    size_t numsamples = left.size();
+    std::vector<std::vector<float>> inL((size_t)instances), inR((size_t)instances);
+    for (size_t k = 0; k < (size_t)instances; k++)
+    {
+        size_t offset = (k * 7919) % numsamples;
+        inL[k].resize(numsamples);
+        inR[k].resize(numsamples);
+        for (size_t i = 0; i < numsamples; i++)
+        {
+            inL[k][i] = left[(i + offset) % numsamples];
+            inR[k][i] = right[(i + offset) % numsamples];
+        }
+    }
+    auto makeInstances = [&]()
+    {
+        std::vector<std::unique_ptr<Compressor>> comps;
+        for (int k = 0; k < instances; k++)
+        {
+            comps.push_back(std::make_unique<Compressor>());
+            configure(*comps.back(), preset, samplerate, false, 1, 2, Compressor::maxlink, 0.0f);
+            // the bank takes the settings as they are, the compressors should not fade into them either
+            comps.back()->reset();
+        }
+        return comps;
+    };
+
+    cycles = 0.0;
+    std::vector<std::vector<float>> outL, outR;
+    for (size_t r = 0; r < nspersample.size(); r++)
+    {
+        // fresh instances per repeat so every run starts from the same state
+        auto comps = makeInstances();
+        outL = inL;
+        outR = inR;
+        switch (lanes)
+        {
+        case 4: nspersample[r] = runBank<4>(comps, samplerate, blocksize, outL, outR, cycles); break;
+        case 8: nspersample[r] = runBank<8>(comps, samplerate, blocksize, outL, outR, cycles); break;
+        case 16: nspersample[r] = runBank<16>(comps, samplerate, blocksize, outL, outR, cycles); break;
+        default: nspersample[r] = runInstances(comps, blocksize, outL, outR, cycles); break;
+        }
+    }
+
+    deviation = -INFINITY;
+    if (lanes > 0)
+    {
+        auto comps = makeInstances();
+        std::vector<std::vector<float>> refL = inL, refR = inR;
+        double refcycles = 0.0;
+        runInstances(comps, blocksize, refL, refR, refcycles);
+        float largest = 0.0f;
+        for (size_t k = 0; k < (size_t)instances; k++)
+        {
+            for (size_t i = 0; i < numsamples; i++)
+            {
+                largest = std::max(largest, std::abs(outL[k][i] - refL[k][i]));
+                largest = std::max(largest, std::abs(outR[k][i] - refR[k][i]));
+            }
+        }
+        deviation = 20.0 * log10((double)largest);
+    }
+}
+
+static void reportTimes(const std::vector<double>& nspersample, double& mean, double& min, double& variance)
+{
+    int repeats = (int)nspersample.size();
+    mean = 0.0;
+    min = nspersample[0];
+    for (double v : nspersample)
+    {
+        mean += v;
+        min = v < min ? v : min;
+    }
+    mean /= repeats;
+    variance = 0.0;
+    for (double v : nspersample)
+        variance += (v - mean) * (v - mean);
+    variance /= (repeats - 1);
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = 1.0;
+    int repeats = 5;
+    bool quick = false;
+    int decimation = 1;
+    int numchannels = 2;
+    int link = Compressor::maxlink;
+    int stems = 0;
+    int oversampling = 1;
+    bool detectoronly = false;
+    float rmswindow = 0.0f;
+    int bank = 0;
+    const char* linknames[] = { "peak", "mean", "rms", "unlinked" };
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+            repeats = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else if (strcmp(argv[i], "--decimation") == 0 && i + 1 < argc)
+            decimation = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc)
+            numchannels = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stems") == 0 && i + 1 < argc)
+            stems = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--oversampling") == 0 && i + 1 < argc)
+            oversampling = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--detector") == 0)
+            detectoronly = true;
+        else if (strcmp(argv[i], "--rmswindow") == 0 && i + 1 < argc)
+            rmswindow = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--bank") == 0 && i + 1 < argc)
+            bank = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--link") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            for (link = 0; link < 4 && strcmp(name, linknames[link]) != 0; link++)
+                ;
+        }
+        else
+            link = -1;
+        if (link < 0 || link > 3)
+        {
+            fprintf(stderr, "usage: %s [--seconds s] [--repeats n] [--quick] [--decimation n] [--channels n]"
+                " [--link peak|mean|rms|unlinked] [--stems n] [--oversampling n] [--detector] [--rmswindow s]"
+                " [--bank n]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+    if (numchannels < 1)
+        numchannels = 1;
+    if (numchannels > SF_COMPRESSOR_MAXCHANNELS)
+        numchannels = SF_COMPRESSOR_MAXCHANNELS;
+    if (repeats < 2)
+        repeats = 2;
+    if (stems < 0)
+        stems = 0;
+    // the split processing has no oversampled engine around it, only its detector can be
+    oversampling = Oversampler::normalize(oversampling);
+    if (stems > 0)
+        detectoronly = true;
+    {
+        // report the control rate the compressor actually uses
+        Compressor comp;
+        comp.set_decimation(decimation);
+        decimation = comp.getDecimation();
+    }
+
+    std::vector<int> blocksizes = { 1, 16, 64, 256, 1024, 4096 };
+    std::vector<int> samplerates = { 44100, 48000, 96000, 192000 };
+    if (quick)
+    {
+        blocksizes = { 1, 64, 512, 4096 };
+        samplerates = { 48000 };
+    }
+
+    if (bank > 0)
+    {
+        printf("mode,preset,signal,samplerate,blocksize,ns_per_sample,ns_per_sample_min,ns_per_sample_variance,"
+            "cycles_per_sample,max_deviation_db\n");
+        for (const Preset& preset : presets)
+        for (int signal = 0; signal < 4; signal++)
+        for (int samplerate : samplerates)
+        {
+            int numsamples = (int)(seconds * samplerate);
+            std::vector<float> inL((size_t)numsamples), inR((size_t)numsamples);
+            fillSignal(signal, samplerate, inL, inR);
+
+            for (int blocksize : blocksizes)
+            for (int lanes : { 0, 4, 8, 16 })
+            {
+                std::vector<double> nspersample((size_t)repeats);
+                double cycles = 0.0, deviation = 0.0;
+                measureBank(preset, samplerate, lanes, bank, blocksize, inL, inR, nspersample, cycles, deviation);
+                double mean, min, variance;
+                reportTimes(nspersample, mean, min, variance);
+                char mode[64];
+                if (lanes > 0)
+                    snprintf(mode, sizeof(mode), "lanes%d-bank%d", lanes, bank);
+                else
+                    snprintf(mode, sizeof(mode), "exact-bank%d", bank);
+                printf("%s,%s,%s,%d,%d,%.3f,%.3f,%.4f,%.2f,%.1f\n", mode, preset.name, signalnames[signal],
+                    samplerate, blocksize, mean, min, variance, BENCH_HAS_TSC ? cycles / repeats : -1.0, deviation);
+                fflush(stdout);
+            }
+        }
+        return 0;
+    }
+
+    // cycles_per_sample is -1 on platforms without a readable cycle counter
+    printf("mode,preset,signal,samplerate,blocksize,ns_per_sample,ns_per_sample_min,ns_per_sample_variance,cycles_per_sample\n");
+
+    for (int precision = 0; precision < 2; precision++)
+    for (int fast = 0; fast < 2; fast++)
+    for (const Preset& preset : presets)
+    for (int signal = 0; signal < 4; signal++)
+    for (int samplerate : samplerates)
+    {
+        int numsamples = (int)(seconds * samplerate);
+        std::vector<float> inL((size_t)numsamples), inR((size_t)numsamples);
+        fillSignal(signal, samplerate, inL, inR);
+
+        for (int blocksize : blocksizes)
+        {
+            std::vector<double> nspersample((size_t)repeats);
+            double cycles = 0.0;
+            if (precision == 0)
+                measure<float>(preset, samplerate, fast != 0, decimation, numchannels, link, stems, oversampling,
+                    detectoronly, rmswindow, blocksize, inL, inR, nspersample, cycles);
+            else
+                measure<double>(preset, samplerate, fast != 0, decimation, numchannels, link, stems, oversampling,
+                    detectoronly, rmswindow, blocksize, inL, inR, nspersample, cycles);
+
+            double mean, min, variance;
+            reportTimes(nspersample, mean, min, variance);
+
+            // eco, double, multichannel, split, oversampled and RMS runs are told apart in the mode name,
+            // e.g. exact-eco4, fast-eco4-double, exact-16ch-rms, exact-stems20, exact-os4det or
+            // exact-rms300ms. ns_per_sample is per frame of all channels at the input rate, of the key and
+            // all targets for split runs
+            char mode[64];
+            snprintf(mode, sizeof(mode), decimation > 1 ? "%s-eco%d" : "%s", fast ? "fast" : "exact", decimation);
+            if (precision == 1)
+                strncat(mode, "-double", sizeof(mode) - strlen(mode) - 1);
+            if (numchannels != 2 || link != Compressor::maxlink)
+            {
+                char channels[32];
+                snprintf(channels, sizeof(channels), "-%dch-%s", numchannels, linknames[link]);
+                strncat(mode, channels, sizeof(mode) - strlen(mode) - 1);
+            }
+            if (stems > 0)
+            {
+                char split[32];
+                snprintf(split, sizeof(split), "-stems%d", stems);
+                strncat(mode, split, sizeof(mode) - strlen(mode) - 1);
+            }
+            if (oversampling > 1)
+            {
+                char resampled[32];
+                snprintf(resampled, sizeof(resampled), detectoronly ? "-os%ddet" : "-os%d", oversampling);
+                strncat(mode, resampled, sizeof(mode) - strlen(mode) - 1);
+            }
+            if (rmswindow > 0.0f)
+            {
+                char window[32];
+                snprintf(window, sizeof(window), "-rms%gms", rmswindow * 1000.0f);
+                strncat(mode, window, sizeof(mode) - strlen(mode) - 1);
+            }
+            printf("%s,%s,%s,%d,%d,%.3f,%.3f,%.4f,%.2f\n", mode, preset.name,
+                signalnames[signal], samplerate, blocksize, mean, min, variance,
+                BENCH_HAS_TSC ? cycles / repeats : -1.0);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
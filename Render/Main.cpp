@@ -0,0 +1,256 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 17 Oct 2026 5:40:12pm
+    Author:  marks
+
+    Command line renderer, runs audio files through the Compressor offline.
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include "SegmentedRenderer.h"
+#include "WorkStealingPool.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+static void printUsage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s [options] input.wav output.wav\n"
+        "       %s [options] --batch outdir input.wav [input.wav ...]\n"
+        "\n"
+        "  --pregain dB      (default 0)\n"
+        "  --threshold dB    (default -12)\n"
+        "  --knee dB         (default 30)\n"
+        "  --ratio r         (default 12)\n"
+        "  --attack s        (default 0.003)\n"
+        "  --release s       (default 0.25)\n"
+        "  --predelay s      (default 0.006)\n"
+        "  --postgain dB     (default 0)\n"
+        "  --wet 0..1        (default 1)\n"
+        "  --fast            use the fast-math curve table\n"
+        "  --decimation n    eco mode, run the detector every 1, 2, 4, 8 or 16 samples (default 1)\n"
+        "  --link mode       peak, mean, rms or unlinked, how the channels share the detector (default peak)\n"
+        "  --rmswindow s     RMS detector over a window of s seconds, up to 0.5 (default 0, the peak detector)\n"
+        "  --block n         samples per processing block (default 65536)\n"
+        "  --jobs n          worker threads in batch and segment mode (default: number of cores)\n"
+        "  --segments n      render a single file as n segments in parallel (default 1)\n"
+        "  --warmup s        pre-roll before each segment (default 10)\n"
+        "  --seam s          window both segments render at a seam to find the join (default 1)\n",
+        name, name);
+}
+
+// parses one option into settings, returns the number of arguments consumed or 0 if unknown
+static int parseOption(int argc, char* argv[], int i, RenderSettings& settings)
+{
+    struct { const char* name; float* value; } floatoptions[] = {
+        { "--pregain", &settings.pregain },
+        { "--threshold", &settings.threshold },
+        { "--knee", &settings.knee },
+        { "--ratio", &settings.ratio },
+        { "--attack", &settings.attack },
+        { "--release", &settings.release },
+        { "--predelay", &settings.predelay },
+        { "--postgain", &settings.postgain },
+        { "--wet", &settings.wet },
+        { "--rmswindow", &settings.rmswindow },
+        { "--warmup", &settings.warmup },
+        { "--seam", &settings.seamwindow },
+    };
+    for (auto& option : floatoptions)
+    {
+        if (strcmp(argv[i], option.name) == 0 && i + 1 < argc)
+        {
+            *option.value = (float)atof(argv[i + 1]);
+            return 2;
+        }
+    }
+    if (strcmp(argv[i], "--fast") == 0)
+    {
+        settings.fastmath = true;
+        return 1;
+    }
+    if (strcmp(argv[i], "--decimation") == 0 && i + 1 < argc)
+    {
+        settings.decimation = juce::jmax(1, atoi(argv[i + 1]));
+        return 2;
+    }
+    if (strcmp(argv[i], "--link") == 0 && i + 1 < argc)
+    {
+        const char* modes[] = { "peak", "mean", "rms", "unlinked" };
+        for (int mode = 0; mode < 4; mode++)
+        {
+            if (strcmp(argv[i + 1], modes[mode]) == 0)
+            {
+                settings.link = (Compressor::LinkMode)mode;
+                return 2;
+            }
+        }
+        return 0;
+    }
+    if (strcmp(argv[i], "--block") == 0 && i + 1 < argc)
+    {
+        settings.blocksize = juce::jmax(1, atoi(argv[i + 1]));
+        return 2;
+    }
+    if (strcmp(argv[i], "--segments") == 0 && i + 1 < argc)
+    {
+        settings.segments = juce::jmax(1, atoi(argv[i + 1]));
+        return 2;
+    }
+    return 0;
+}
+
+static int renderBatch(const RenderSettings& settings, const juce::File& outdir, const juce::StringArray& files, int numjobs)
+{
+    juce::File cwd = juce::File::getCurrentWorkingDirectory();
+    WorkStealingPool pool(numjobs);
+
+    // one renderer (compressor and i/o buffers) per worker, reused for every file it picks up
+    std::vector<std::unique_ptr<OfflineRenderer>> renderers;
+    std::vector<double> audioseconds((size_t)pool.getNumWorkers(), 0.0);
+    for (int w = 0; w < pool.getNumWorkers(); w++)
+    {
+        renderers.push_back(std::make_unique<OfflineRenderer>(settings));
+    }
+
+    std::atomic<int> failures { 0 };
+    juce::int64 start = juce::Time::getHighResolutionTicks();
+    pool.run(files.size(), [&](int worker, int item)
+    {
+        juce::File input = cwd.getChildFile(files[item]);
+        juce::File output = outdir.getChildFile(input.getFileNameWithoutExtension() + ".wav");
+        OfflineRenderer& renderer = *renderers[(size_t)worker];
+        juce::String error;
+        if (!renderer.render(input, output, error))
+        {
+            fprintf(stderr, "%s\n", error.toRawUTF8());
+            failures++;
+            return;
+        }
+        if (renderer.getRenderedSampleRate() > 0.0)
+        {
+            audioseconds[(size_t)worker] += (double)renderer.getRenderedSamples() / renderer.getRenderedSampleRate();
+        }
+    });
+    double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    double totalaudioseconds = 0.0;
+    for (double s : audioseconds)
+    {
+        totalaudioseconds += s;
+    }
+    double realtime = seconds > 0.0 ? totalaudioseconds / seconds : 0.0;
+    printf("%d files (%d failed), %.1f s of audio in %.2f s on %d workers: %.1fx realtime, %.1fx realtime per core\n",
+        files.size(), failures.load(), totalaudioseconds, seconds, pool.getNumWorkers(),
+        realtime, realtime / pool.getNumWorkers());
+    return failures.load() == 0 ? 0 : 1;
+}
+
+static int renderSegmented(const RenderSettings& settings, const juce::File& input, const juce::File& output, int numjobs)
+{
+    WorkStealingPool pool(numjobs);
+    SegmentedRenderer renderer(settings);
+    juce::String error;
+    juce::int64 start = juce::Time::getHighResolutionTicks();
+    if (!renderer.render(input, output, pool, error))
+    {
+        fprintf(stderr, "%s\n", error.toRawUTF8());
+        return 1;
+    }
+    double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    for (const SegmentedRenderer::Seam& seam : renderer.getSeams())
+    {
+        if (seam.exact)
+            printf("seam at %lld: exact join at %lld\n", (long long)seam.position, (long long)seam.join);
+        else
+            printf("seam at %lld: state did not converge, joined at %lld with error %g (%.1f dB)\n",
+                (long long)seam.position, (long long)seam.join, seam.error,
+                juce::Decibels::gainToDecibels(seam.error));
+    }
+    double audioseconds = renderer.getRenderedSampleRate() > 0.0
+        ? (double)renderer.getRenderedSamples() / renderer.getRenderedSampleRate() : 0.0;
+    printf("%s: %.1f s of audio in %.2f s as %d segments on %d workers (%.1fx realtime)\n",
+        output.getFileName().toRawUTF8(), audioseconds, seconds, (int)renderer.getSeams().size() + 1,
+        pool.getNumWorkers(), seconds > 0.0 ? audioseconds / seconds : 0.0);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    RenderSettings settings;
+    juce::StringArray files;
+    juce::String batchdir;
+    int numjobs = juce::SystemStats::getNumCpus();
+    for (int i = 1; i < argc;)
+    {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            batchdir = argv[i + 1];
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+        {
+            numjobs = juce::jmax(1, atoi(argv[i + 1]));
+            i += 2;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] == '-')
+        {
+            int used = parseOption(argc, argv, i, settings);
+            if (used == 0)
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            i += used;
+        }
+        else
+        {
+            files.add(argv[i++]);
+        }
+    }
+
+    juce::File cwd = juce::File::getCurrentWorkingDirectory();
+    if (batchdir.isNotEmpty())
+    {
+        juce::File outdir = cwd.getChildFile(batchdir);
+        if (files.size() == 0 || !outdir.isDirectory())
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return renderBatch(settings, outdir, files, numjobs);
+    }
+
+    if (files.size() != 2)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    juce::File input = cwd.getChildFile(files[0]);
+    juce::File output = cwd.getChildFile(files[1]);
+    if (settings.segments > 1)
+    {
+        return renderSegmented(settings, input, output, numjobs);
+    }
+    OfflineRenderer renderer(settings);
+    juce::String error;
+    juce::int64 start = juce::Time::getHighResolutionTicks();
+    if (!renderer.render(input, output, error))
+    {
+        fprintf(stderr, "%s\n", error.toRawUTF8());
+        return 1;
+    }
+    double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    double audioseconds = renderer.getRenderedSampleRate() > 0.0
+        ? (double)renderer.getRenderedSamples() / renderer.getRenderedSampleRate() : 0.0;
+    printf("%s: %.1f s of audio in %.2f s (%.1fx realtime)\n", output.getFileName().toRawUTF8(),
+        audioseconds, seconds, seconds > 0.0 ? audioseconds / seconds : 0.0);
+    return 0;
+}
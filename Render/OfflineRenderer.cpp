@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+    Created: 17 Oct 2026 5:40:12pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+
+OfflineRenderer::OfflineRenderer(const RenderSettings& settings_in)
+    : settings(settings_in)
+{
+}
+
+void OfflineRenderer::configure(Compressor& comp, const RenderSettings& settings, int samplerate)
+{
+    comp.setSampleRate(samplerate);
+    comp.set_linearpregain(settings.pregain);
+    comp.set_linearthreshold(settings.threshold);
+    comp.set_slope(1.0f / settings.ratio);
+    comp.calculate_knee(settings.knee);
+    comp.set_attack(samplerate, settings.attack);
+    comp.set_release(samplerate, settings.release);
+    comp.set_delaybufsize(samplerate, settings.predelay);
+    comp.set_postgain(settings.postgain);
+    comp.set_wetlevel(settings.wet);
+    comp.set_fastmath(settings.fastmath);
+    comp.set_decimation(settings.decimation);
+    comp.set_link(settings.link);
+    comp.set_rmswindow(samplerate, settings.rmswindow);
+}
+
+std::unique_ptr<juce::AudioFormatReader> OfflineRenderer::createReader(const juce::File& input)
+{
+    // map the file so that reads are served straight from the page cache
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(wav.createMemoryMappedReader(input));
+    if (mapped != nullptr && mapped->mapEntireFile())
+    {
+        return mapped;
+    }
+
+    // not a mappable wav file, fall back to a plain streaming reader
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    return std::unique_ptr<juce::AudioFormatReader>(formats.createReaderFor(input));
+}
+
+std::unique_ptr<juce::AudioFormatWriter> OfflineRenderer::createWriter(const juce::File& output, double samplerate,
+    int numchannels, int bitspersample, juce::String& error)
+{
+    output.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream(output.createOutputStream(1 << 20));
+    if (stream == nullptr || stream->failedToOpen())
+    {
+        error = "cannot write " + output.getFullPathName();
+        return nullptr;
+    }
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), samplerate,
+        (unsigned int)numchannels, bitspersample, {}, 0));
+    if (writer == nullptr)
+    {
+        error = "cannot create a wav writer for " + output.getFullPathName();
+        return nullptr;
+    }
+    stream.release(); // the writer owns the stream now
+    return writer;
+}
+
+bool OfflineRenderer::render(const juce::File& input, const juce::File& output, juce::String& error)
+{
+    renderedsamples = 0;
+    renderedsamplerate = 0.0;
+
+    std::unique_ptr<juce::AudioFormatReader> reader = createReader(input);
+    if (reader == nullptr)
+    {
+        error = "cannot read " + input.getFullPathName();
+        return false;
+    }
+    int numchannels = (int)reader->numChannels;
+    if (numchannels > SF_COMPRESSOR_MAXCHANNELS)
+    {
+        error = input.getFullPathName() + " has more than " + juce::String(SF_COMPRESSOR_MAXCHANNELS) + " channels";
+        return false;
+    }
+
+    int bitspersample = reader->bitsPerSample >= 16 ? (int)reader->bitsPerSample : 16;
+    std::unique_ptr<juce::AudioFormatWriter> writer = createWriter(output, reader->sampleRate, numchannels,
+        bitspersample, error);
+    if (writer == nullptr)
+    {
+        return false;
+    }
+
+    // every file starts from the same compressor state, with a ring just long enough for its predelay
+    comp.prepare((int)reader->sampleRate, numchannels, settings.predelay);
+    configure(comp, settings, (int)reader->sampleRate);
+    comp.reset();
+    buffer.setSize(numchannels, settings.blocksize, false, false, true);
+
+    juce::int64 length = reader->lengthInSamples;
+    for (juce::int64 pos = 0; pos < length; pos += settings.blocksize)
+    {
+        int len = (int)juce::jmin((juce::int64)settings.blocksize, length - pos);
+        reader->read(&buffer, 0, len, pos, true, true);
+        comp.processBuffer(buffer.getArrayOfReadPointers(), buffer.getArrayOfWritePointers(), numchannels, len);
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, len))
+        {
+            error = "write failed for " + output.getFullPathName();
+            return false;
+        }
+    }
+
+    renderedsamples = length;
+    renderedsamplerate = reader->sampleRate;
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+    Created: 17 Oct 2026 5:40:12pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "../Source/Compressor.h"
+
+// all nine user parameters of the compressor, in the same units as the plugin dials
+struct RenderSettings
+{
+    float pregain = 0.0f; // dB
+    float threshold = -12.0f; // dB
+    float knee = 30.0f; // dB
+    float ratio = 12.0f;
+    float attack = 0.003f; // seconds
+    float release = 0.250f; // seconds
+    float predelay = 0.006f; // seconds
+    float postgain = 0.0f; // dB
+    float wet = 1.0f; // 0..1
+    bool fastmath = false;
+    int decimation = 1; // control rate, see Compressor::set_decimation
+    Compressor::LinkMode link = Compressor::maxlink; // how the channels share the detector
+    float rmswindow = 0.0f; // seconds, 0 for the peak detector, see Compressor::set_rmswindow
+    int blocksize = 65536; // samples per read/process/write cycle
+    int segments = 1; // parallel segments of a single file, see SegmentedRenderer
+    float warmup = 10.0f; // seconds of pre-roll before each segment
+    float seamwindow = 1.0f; // seconds rendered by both segments at a seam to find the join
+};
+
+// renders WAV files through a Compressor without any GUI or audio device. the input is memory
+// mapped when possible and always processed in blocks of RenderSettings::blocksize, so memory use
+// stays constant no matter how long the file is
+class OfflineRenderer
+{
+
+public:
+
+    OfflineRenderer(const RenderSettings& settings_in);
+    bool render(const juce::File& input, const juce::File& output, juce::String& error);
+    juce::int64 inline getRenderedSamples() { return renderedsamples; }
+    double inline getRenderedSampleRate() { return renderedsamplerate; }
+
+    static void configure(Compressor& comp, const RenderSettings& settings, int samplerate);
+    static std::unique_ptr<juce::AudioFormatReader> createReader(const juce::File& input);
+    // replaces output with an empty wav file, nullptr with error set when that fails
+    static std::unique_ptr<juce::AudioFormatWriter> createWriter(const juce::File& output, double samplerate,
+        int numchannels, int bitspersample, juce::String& error);
+
+private:
+
+    RenderSettings settings;
+    Compressor comp;
+    juce::AudioBuffer<float> buffer;
+    juce::int64 renderedsamples = 0;
+    double renderedsamplerate = 0.0;
+};
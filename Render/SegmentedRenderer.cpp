@@ -0,0 +1,229 @@
+/*
+  ==============================================================================
+
+    SegmentedRenderer.cpp
+    Created: 17 Oct 2026 9:05:37pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#include "SegmentedRenderer.h"
+#include <atomic>
+#include <numeric>
+
+SegmentedRenderer::SegmentedRenderer(const RenderSettings& settings_in)
+    : settings(settings_in)
+{
+}
+
+bool SegmentedRenderer::render(const juce::File& input, const juce::File& output, WorkStealingPool& pool, juce::String& error)
+{
+    renderedsamples = 0;
+    renderedsamplerate = 0.0;
+    seams.clear();
+
+    std::unique_ptr<juce::AudioFormatReader> reader = OfflineRenderer::createReader(input);
+    if (reader == nullptr)
+    {
+        error = "cannot read " + input.getFullPathName();
+        return false;
+    }
+    numchannels = (int)reader->numChannels;
+    if (numchannels > SF_COMPRESSOR_MAXCHANNELS)
+    {
+        error = input.getFullPathName() + " has more than " + juce::String(SF_COMPRESSOR_MAXCHANNELS) + " channels";
+        return false;
+    }
+    samplerate = reader->sampleRate;
+    juce::int64 length = reader->lengthInSamples;
+
+    // everything is placed on the chunk grid, so every compressor sees the same chunks as a sequential
+    // render would, and the states can be compared at the boundaries
+    const int spu = SF_COMPRESSOR_SPU;
+    blocksize = juce::jmax(spu, settings.blocksize / spu * spu);
+    seamsamples = juce::jmax(spu, (int)ceil(settings.seamwindow * samplerate / spu) * spu);
+    // the pre-roll also has to fill the predelay ring with the input a sequential render would hold
+    juce::int64 warmupsamples = juce::jmax((juce::int64)llround(settings.warmup * samplerate),
+        (juce::int64)lroundf((float)samplerate * settings.predelay) + spu);
+
+    // segments shorter than two seam windows would spend most of their time on the seams
+    juce::int64 maxsegments = juce::jmax((juce::int64)1, length / (2 * seamsamples));
+    int numsegments = (int)juce::jlimit((juce::int64)1, maxsegments, (juce::int64)settings.segments);
+    juce::int64 segmentlength = ((length + numsegments - 1) / numsegments + spu - 1) / spu * spu;
+    std::vector<Segment> segments;
+    for (juce::int64 start = 0; start < length || segments.empty(); start += segmentlength)
+    {
+        Segment segment;
+        segment.start = start;
+        segment.end = juce::jmin(length, start + segmentlength);
+        segment.renderend = juce::jmin(length, segment.end + seamsamples);
+        segment.temp = std::make_unique<juce::TemporaryFile>(output);
+        segments.push_back(std::move(segment));
+    }
+    numsegments = (int)segments.size();
+    segments.back().renderend = segments.back().end;
+
+    std::atomic<int> failures { 0 };
+    pool.run(numsegments, [&](int, int item)
+    {
+        Segment& segment = segments[(size_t)item];
+        juce::int64 prerollstart = juce::jmax((juce::int64)0, (segment.start - warmupsamples) / spu * spu);
+        if (!renderSegment(input, segment, prerollstart, item == 0))
+        {
+            failures++;
+        }
+    });
+    if (failures.load() > 0)
+    {
+        for (const Segment& segment : segments)
+        {
+            if (segment.error.isNotEmpty())
+            {
+                error = segment.error;
+                break;
+            }
+        }
+        return false;
+    }
+
+    for (int i = 1; i < numsegments; i++)
+    {
+        seams.push_back(findJoin(segments[(size_t)(i - 1)], segments[(size_t)i]));
+    }
+
+    // stitch the segments together, each one from its join to the next
+    int bitspersample = reader->bitsPerSample >= 16 ? (int)reader->bitsPerSample : 16;
+    std::unique_ptr<juce::AudioFormatWriter> writer = OfflineRenderer::createWriter(output, samplerate, numchannels,
+        bitspersample, error);
+    if (writer == nullptr)
+    {
+        return false;
+    }
+    juce::AudioBuffer<float> buffer(numchannels, blocksize);
+    for (int i = 0; i < numsegments; i++)
+    {
+        const Segment& segment = segments[(size_t)i];
+        juce::int64 from = i == 0 ? 0 : seams[(size_t)(i - 1)].join;
+        juce::int64 to = i == numsegments - 1 ? length : seams[(size_t)i].join;
+        std::unique_ptr<juce::AudioFormatReader> part = OfflineRenderer::createReader(segment.temp->getFile());
+        if (part == nullptr)
+        {
+            error = "cannot read back " + segment.temp->getFile().getFullPathName();
+            return false;
+        }
+        for (juce::int64 pos = from; pos < to; pos += blocksize)
+        {
+            int len = (int)juce::jmin((juce::int64)blocksize, to - pos);
+            part->read(&buffer, 0, len, pos - segment.start, true, true);
+            if (!writer->writeFromAudioSampleBuffer(buffer, 0, len))
+            {
+                error = "write failed for " + output.getFullPathName();
+                return false;
+            }
+        }
+    }
+
+    renderedsamples = length;
+    renderedsamplerate = samplerate;
+    return true;
+}
+
+bool SegmentedRenderer::renderSegment(const juce::File& input, Segment& segment, juce::int64 prerollstart, bool first)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader = OfflineRenderer::createReader(input);
+    if (reader == nullptr)
+    {
+        segment.error = "cannot read " + input.getFullPathName();
+        return false;
+    }
+    std::unique_ptr<juce::AudioFormatWriter> writer = OfflineRenderer::createWriter(segment.temp->getFile(),
+        samplerate, numchannels, 32, segment.error);
+    if (writer == nullptr)
+    {
+        return false;
+    }
+
+    // the same start as a sequential render, only earlier in the file
+    auto comp = std::make_unique<Compressor>();
+    comp->prepare((int)samplerate, numchannels, settings.predelay);
+    OfflineRenderer::configure(*comp, settings, (int)samplerate);
+    comp->reset();
+    // a sequential render swaps in the fresh RMS sums every window from sample 0 on, so the pre-roll
+    // starts on such a swap as well, or the two renders never reach the same state
+    int window = comp->getRmsWindowSamples();
+    if (window > 0)
+    {
+        juce::int64 grid = std::lcm((juce::int64)SF_COMPRESSOR_SPU, (juce::int64)window);
+        prerollstart = prerollstart / grid * grid;
+    }
+
+    juce::AudioBuffer<float> buffer(numchannels, blocksize);
+    juce::int64 headend = first ? segment.start : juce::jmin(segment.start + seamsamples, segment.end);
+    for (juce::int64 pos = prerollstart; pos < segment.renderend;)
+    {
+        // the seam windows go one chunk at a time, so the state can be taken at every boundary
+        bool inhead = pos >= segment.start && pos < headend;
+        bool intail = pos >= segment.end;
+        juce::int64 stop = segment.renderend;
+        for (juce::int64 edge : { segment.start, headend, segment.end })
+        {
+            stop = edge > pos && edge < stop ? edge : stop;
+        }
+        int len = (int)juce::jmin((juce::int64)(inhead || intail ? SF_COMPRESSOR_SPU : blocksize), stop - pos);
+
+        reader->read(&buffer, 0, len, pos, true, true);
+        comp->processBuffer(buffer.getArrayOfReadPointers(), buffer.getArrayOfWritePointers(), numchannels, len);
+        if (inhead || intail)
+        {
+            std::vector<Compressor::EnvelopeState>& states = inhead ? segment.headstates : segment.tailstates;
+            std::vector<float>& outputs = inhead ? segment.headoutput : segment.tailoutput;
+            states.push_back(comp->getEnvelopeState());
+            for (int i = 0; i < len; i++)
+            {
+                for (int ch = 0; ch < numchannels; ch++)
+                {
+                    outputs.push_back(buffer.getSample(ch, i));
+                }
+            }
+        }
+        // the pre-roll is only there for the state
+        if (pos >= segment.start && !writer->writeFromAudioSampleBuffer(buffer, 0, len))
+        {
+            segment.error = "write failed for " + segment.temp->getFile().getFullPathName();
+            return false;
+        }
+        pos += len;
+    }
+    return true;
+}
+
+SegmentedRenderer::Seam SegmentedRenderer::findJoin(const Segment& before, const Segment& after)
+{
+    // chunk j of both windows covers the same samples, so equal states after it make an exact join
+    Seam seam;
+    seam.position = after.start;
+    size_t chunks = juce::jmin(before.tailstates.size(), after.headstates.size());
+    for (size_t j = 0; j < chunks; j++)
+    {
+        if (before.tailstates[j] == after.headstates[j])
+        {
+            seam.join = juce::jmin(after.start + (juce::int64)(j + 1) * SF_COMPRESSOR_SPU, before.renderend);
+            seam.exact = true;
+            seam.error = 0.0f;
+            return seam;
+        }
+    }
+
+    // never converged, the later segment takes over at the end of the window with whatever error is left
+    seam.join = juce::jmin(after.start + (juce::int64)chunks * SF_COMPRESSOR_SPU, before.renderend);
+    seam.exact = false;
+    seam.error = 0.0f;
+    size_t n = juce::jmin(before.tailoutput.size(), after.headoutput.size());
+    size_t from = n > (size_t)(SF_COMPRESSOR_SPU * numchannels) ? n - (size_t)(SF_COMPRESSOR_SPU * numchannels) : 0;
+    for (size_t i = from; i < n; i++)
+    {
+        seam.error = juce::jmax(seam.error, std::abs(before.tailoutput[i] - after.headoutput[i]));
+    }
+    return seam;
+}
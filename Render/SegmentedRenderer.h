@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    SegmentedRenderer.h
+    Created: 17 Oct 2026 9:05:37pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OfflineRenderer.h"
+#include "WorkStealingPool.h"
+
+// renders one long file on several cores. the file is cut into RenderSettings::segments segments on
+// the chunk grid, and each segment is rendered by its own Compressor. that compressor starts
+// RenderSettings::warmup seconds early, and its output is thrown away until the envelope state
+// has converged. each segment also runs on for RenderSettings::seamwindow seconds past its end.
+// the two renders of that window are compared chunk by chunk, and the next segment takes over at
+// the first chunk boundary where both compressors are in the same state. such a join is exact: the
+// output from there on is bit-identical to a sequential render. when the state does not converge
+// within the window, the join falls at its end and the difference there is reported as the seam error
+class SegmentedRenderer
+{
+
+public:
+
+    // where one segment hands over to the next
+    struct Seam
+    {
+        juce::int64 position; // nominal start of the later segment
+        juce::int64 join; // sample where the output switches to the later segment
+        bool exact; // both renders were in the same state at the join
+        float error; // largest difference in the last chunk before the join, 0 when exact
+    };
+
+    SegmentedRenderer(const RenderSettings& settings_in);
+    bool render(const juce::File& input, const juce::File& output, WorkStealingPool& pool, juce::String& error);
+    juce::int64 inline getRenderedSamples() { return renderedsamples; }
+    double inline getRenderedSampleRate() { return renderedsamplerate; }
+    const std::vector<Seam>& getSeams() { return seams; }
+
+private:
+
+    struct Segment
+    {
+        juce::int64 start; // first sample this segment owns
+        juce::int64 end; // one past the last one, the seam window follows
+        juce::int64 renderend; // end plus the seam window, clipped to the file
+        std::unique_ptr<juce::TemporaryFile> temp; // 32 bit float output from start to renderend
+        // states after every chunk of the seam window at the start and the one past the end, and the
+        // output of the same chunks, interleaved
+        std::vector<Compressor::EnvelopeState> headstates, tailstates;
+        std::vector<float> headoutput, tailoutput;
+        juce::String error;
+    };
+
+    bool renderSegment(const juce::File& input, Segment& segment, juce::int64 prerollstart, bool first);
+    Seam findJoin(const Segment& before, const Segment& after);
+
+    RenderSettings settings;
+    int numchannels = 0;
+    double samplerate = 0.0;
+    int blocksize = SF_COMPRESSOR_SPU; // settings.blocksize on the chunk grid
+    int seamsamples = SF_COMPRESSOR_SPU; // seam window, whole chunks
+    std::vector<Seam> seams;
+    juce::int64 renderedsamples = 0;
+    double renderedsamplerate = 0.0;
+};
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    WorkStealingPool.cpp
+    Created: 17 Oct 2026 6:15:48pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#include "WorkStealingPool.h"
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(int numworkers_in)
+{
+    numworkers = numworkers_in < 1 ? 1 : numworkers_in;
+    for (int i = 0; i < numworkers; i++)
+    {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+}
+
+void WorkStealingPool::run(int numitems, const std::function<void(int worker, int item)>& job)
+{
+    for (int i = 0; i < numitems; i++)
+    {
+        queues[(size_t)(i % numworkers)]->items.push_back(i);
+    }
+
+    auto work = [this, &job](int worker)
+    {
+        int item;
+        while (takeItem(worker, item))
+        {
+            job(worker, item);
+        }
+    };
+
+    // the calling thread is worker 0
+    std::vector<std::thread> threads;
+    for (int w = 1; w < numworkers; w++)
+    {
+        threads.emplace_back(work, w);
+    }
+    work(0);
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+}
+
+bool WorkStealingPool::takeItem(int worker, int& item)
+{
+    {
+        WorkQueue& own = *queues[(size_t)worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.items.empty())
+        {
+            item = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+    for (int i = 1; i < numworkers; i++)
+    {
+        WorkQueue& victim = *queues[(size_t)((worker + i) % numworkers)];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.items.empty())
+        {
+            item = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
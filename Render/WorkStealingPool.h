@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    WorkStealingPool.h
+    Created: 17 Oct 2026 6:15:48pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// a small fixed-size pool for batches of independent jobs. items are dealt round-robin into one
+// queue per worker; a worker takes from the front of its own queue and, once that is empty, steals
+// from the back of the others, so a few long files cannot leave the remaining cores idle
+class WorkStealingPool
+{
+
+public:
+
+    WorkStealingPool(int numworkers_in);
+    int inline getNumWorkers() { return numworkers; }
+    // calls job(worker, item) once for every item in [0, numitems) and returns when all are done.
+    // worker is in [0, getNumWorkers()), so per-worker resources can be indexed by it
+    void run(int numitems, const std::function<void(int worker, int item)>& job);
+
+private:
+
+    struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<int> items;
+    };
+
+    bool takeItem(int worker, int& item);
+
+    int numworkers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+};
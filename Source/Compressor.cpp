@@ -11,9 +11,22 @@
 #include "Compressor.h"
 #include <math.h>
 
-Compressor::Compressor()
+static_assert(SF_OVERSAMPLER_MAXBLOCK >= SF_COMPRESSOR_SPU, "the detector upsamples a chunk at a time");
+
+template <typename Sample>
+BasicCompressor<Sample>::BasicCompressor()
 {
-    allocateDelayBuffer();
+    // stereo at the default rate until the host tells otherwise through prepare
+    allocateDelayBuffer(delayRingFrames(sampleRate, SF_COMPRESSOR_MAXPREDELAY), 2);
+    allocateRmsBuffer(rmsRingFrames(sampleRate), 2);
+    keyoversampler.prepare(SF_COMPRESSOR_MAXCHANNELS, false);
+    for (int p = 0; p < numparameters; p++)
+    {
+        design.smoothingmode[p] = linearsmoothing;
+        design.smoothingtime[p] = SF_COMPRESSOR_SMOOTHTIME;
+        // never equal to a published value, so the first snapshot sets every smoother
+        snapshotparams[p] = NAN;
+    }
     sf_advancecomp(
         0.000f, // pregain
         -12.000f, // threshold
@@ -29,27 +42,20 @@ Compressor::Compressor()
         0.000f, // postgain
         1.000f  // wet
     );
+    // nothing is processing yet, so the first snapshot can be taken right away
+    acquire();
+    delaysamples = cf->delaysamples;
 }
 
-Compressor::~Compressor()
+template <typename Sample>
+BasicCompressor<Sample>::~BasicCompressor()
 {
-    float lMax = 0.0f, rMax = 0.0f;
-    for (int i = 0; i < delaybufsize; i++)
-    {
-        if (delaybufL[i] > lMax)
-        {
-            lMax = delaybufL[i];
-        }
-        if (delaybufR[i] > rMax)
-        {
-            rMax = delaybufR[i];
-        }
-    }
-    free(delaybufL);
-    free(delaybufR);
+    free(delaymem);
+    free(rmsmem);
 }
 
-void Compressor::sf_advancecomp(float pregain, float threshold,
+template <typename Sample>
+void BasicCompressor<Sample>::sf_advancecomp(float pregain, float threshold,
     float knee, float ratio, float attack, float release, float predelay, float releasezone1,
     float releasezone2, float releasezone3, float releasezone4, float postgain, float wet)
 {
@@ -63,7 +69,6 @@ void Compressor::sf_advancecomp(float pregain, float threshold,
     this->release = release;
     set_release(sampleRate, release);
     set_wetlevel(wet);
-    set_meterrelease(sampleRate);
     set_postgain(postgain);
     this->releasezone1 = releasezone1;
     this->releasezone2 = releasezone2;
@@ -73,87 +78,330 @@ void Compressor::sf_advancecomp(float pregain, float threshold,
     calculate_knee(knee);
 }
 
-void Compressor::allocateDelayBuffer()
+template <typename Sample>
+int BasicCompressor<Sample>::delayRingFrames(int sr_in, float maxpredelay)
 {
-    delaybufL = (float*)malloc(SF_COMPRESSOR_MAXDELAY * sizeof(float));
-    delaybufR = (float*)malloc(SF_COMPRESSOR_MAXDELAY * sizeof(float));
-    memset(delaybufL, 0.0, sizeof(float) * SF_COMPRESSOR_MAXDELAY);
-    memset(delaybufR, 0.0, sizeof(float) * SF_COMPRESSOR_MAXDELAY);
+    // one chunk of headroom, the chunk is written before the delayed chunk is read back, and room for
+    // the delay of the oversampled detector
+    int frames = (int)ceilf((float)sr_in * maxpredelay) + SF_COMPRESSOR_SPU
+        + (int)ceil(BasicOversampler<Sample>::upsampleDelay(SF_OVERSAMPLER_MAXFACTOR));
+    int ringframes = SF_COMPRESSOR_SPU;
+    while (ringframes < frames)
+    {
+        ringframes *= 2;
+    }
+    return ringframes;
 }
 
-void Compressor::setSampleRate(int sr_in) 
+template <typename Sample>
+void BasicCompressor<Sample>::allocateDelayBuffer(int frames, int channels)
+{
+    free(delaymem);
+    delaybuf = alignedalloc<Sample>((size_t)frames * (size_t)channels * sizeof(Sample), delaymem);
+    memset(delaybuf, 0, (size_t)frames * (size_t)channels * sizeof(Sample));
+    delaymask = frames - 1;
+    delaychannels = channels;
+    delaywritepos = 0;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::prepare(int sr_in, int inputchannels, float maxpredelay)
+{
+    if (inputchannels < 1)
+    {
+        inputchannels = 1;
+    }
+    else if (inputchannels > SF_COMPRESSOR_MAXCHANNELS)
+    {
+        inputchannels = SF_COMPRESSOR_MAXCHANNELS;
+    }
+    int frames = delayRingFrames(sr_in, maxpredelay);
+    if (frames != delaymask + 1 || inputchannels != delaychannels)
+    {
+        allocateDelayBuffer(frames, inputchannels);
+    }
+    // the detectors never outnumber the channels
+    int rmsframes = rmsRingFrames(sr_in);
+    if (rmsframes != rmsmask + 1 || inputchannels != rmsrows)
+    {
+        allocateRmsBuffer(rmsframes, inputchannels);
+    }
+    // clamps the predelay to the new ring
+    setSampleRate(sr_in);
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::setSampleRate(int sr_in) 
 { 
     sampleRate = sr_in;
+    design.samplerate = sr_in;
     set_delaybufsize(sr_in, predelay);
     set_attack(sr_in, attack);
-    set_meterrelease(sr_in);
+    set_rmswindow(sr_in, rmswindowtime);
     calculate_releasecurve();
+    publish();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::reset()
+{
+    for (Detector& det : detectors)
+    {
+        det = Detector();
+    }
+    clearMeter();
+    acquire();
+    // events that were still gliding land on their values
+    for (int p = 0; p < numparameters; p++)
+    {
+        smoothers[p].current = smoothers[p].target;
+    }
+    smoothing = false;
+    updateLive();
+    // a fresh start, the chunk grid begins at the next sample
+    chunkphase = 0;
+    for (int p = 0; p < numparameters; p++)
+    {
+        pending[p] = false;
+    }
+    memset(delaybuf, 0, (size_t)(delaymask + 1) * (size_t)delaychannels * sizeof(Sample));
+    delaywritepos = 0;
+    keyoversampler.reset();
+    memset(rmsbuf, 0, (size_t)(rmsmask + 1) * (size_t)rmsrows * sizeof(Sample));
+    rmswritepos = 0;
+    rmsfill = 0;
+    rmswindow = cf->rmswindow;
+    // the ring is silent, so the predelay can jump straight to the current setting
+    delaysamples = cf->delaysamples;
+    delayfadeleft = 0;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::joinChunkGrid(const BasicCompressor& leader)
+{
+    chunkphase = leader.chunkphase;
+    metersamples = leader.metersamples;
+    // the first chunk is the rest of one, it gets its envelope rate as if it had started at the boundary
+    if (chunkphase != 0)
+    {
+        calculateEnvelopeRate();
+    }
 }
 
-void Compressor::set_delaybufsize(int sr_in, float predelay)
+template <typename Sample>
+int BasicCompressor<Sample>::rmsRingFrames(int sr_in)
+{
+    int frames = (int)ceilf((float)sr_in * SF_COMPRESSOR_MAXRMSWINDOW);
+    int ringframes = SF_COMPRESSOR_SPU;
+    while (ringframes < frames)
+    {
+        ringframes *= 2;
+    }
+    return ringframes;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::allocateRmsBuffer(int frames, int rows)
+{
+    free(rmsmem);
+    rmsbuf = alignedalloc<Sample>((size_t)frames * (size_t)rows * sizeof(Sample), rmsmem);
+    memset(rmsbuf, 0, (size_t)frames * (size_t)rows * sizeof(Sample));
+    rmsmask = frames - 1;
+    rmsrows = rows;
+    rmswritepos = 0;
+    rmsfill = 0;
+    // the rows are silent, the sums start over with them
+    for (Detector& det : detectors)
+    {
+        det.rmssum = 0.0f;
+        det.rmsfresh = 0.0f;
+    }
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::set_delaybufsize(int sr_in, float predelay)
 {
     sampleRate = sr_in;
+    design.samplerate = sr_in;
     this->predelay = predelay;
-    delaybufsize = sampleRate * predelay;
-    if (delaybufsize < 1)
+    design.delaysamples = (int)lroundf((float)sampleRate * predelay);
+    // the audio waits for the upsampled detector as well
+    if (design.oversampling > 1)
     {
-        delaybufsize = 1;
+        design.delaysamples += (int)lround(BasicOversampler<Sample>::upsampleDelay(design.oversampling));
     }
-    else if (delaybufsize > SF_COMPRESSOR_MAXDELAY)
+    // longer than prepare allowed for: the ring is not resized here, so the predelay is clamped
+    jassert(design.delaysamples <= delaymask + 1 - SF_COMPRESSOR_SPU);
+    if (design.delaysamples < 0)
     {
-        delaybufsize = SF_COMPRESSOR_MAXDELAY;
+        design.delaysamples = 0;
     }
-    delaywritepos = 0;
-    delayreadpos = delaybufsize;
+    else if (design.delaysamples > delaymask + 1 - SF_COMPRESSOR_SPU)
+    {
+        design.delaysamples = delaymask + 1 - SF_COMPRESSOR_SPU;
+    }
+    publish();
 }
 
-void Compressor::set_linearpregain(float val_in)
+template <typename Sample>
+void BasicCompressor<Sample>::set_detectoroversampling(int factor)
 {
-    linearpregain = db2lin(val_in);
+    design.oversampling = BasicOversampler<Sample>::normalize(factor);
+    // publishes the predelay with the new detector delay
+    set_delaybufsize(sampleRate, predelay);
 }
 
-void Compressor::set_linearthreshold(float val_in)
+template <typename Sample>
+void BasicCompressor<Sample>::set_rmswindow(int sr_in, float window_in)
 {
-    threshold = val_in;
-    linearthreshold = db2lin(val_in);
-    calculate_knee(knee);
+    rmswindowtime = window_in > 0.0f ? window_in : 0.0f;
+    int window = (int)lroundf((float)sr_in * rmswindowtime);
+    // any window at all is at least one sample, one sample is the magnitude of the level
+    if (rmswindowtime > 0.0f && window < 1)
+    {
+        window = 1;
+    }
+    // longer than prepare allowed for: the rows are not resized here, so the window is clamped
+    jassert(window <= rmsmask + 1);
+    design.rmswindow = window < rmsmask + 1 ? window : rmsmask + 1;
+    publish();
 }
 
-void Compressor::set_slope(float val_in)
+template <typename Sample>
+void BasicCompressor<Sample>::set_zerolatency(bool enabled)
 {
-    slope = val_in;
-    calculate_knee(knee);
+    design.zerolatency = enabled;
+    publish();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::set_smoothing(int parameter, Smoothing mode, float seconds)
+{
+    jassert(parameter >= 0 && parameter < numparameters);
+    design.smoothingmode[parameter] = mode;
+    design.smoothingtime[parameter] = seconds > 0.0f ? seconds : 0.0f;
+    publish();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::set_linearpregain(float val_in)
+{
+    design.params[pregainparam] = val_in;
+    design.linearpregain = db2lin(val_in);
+    publish();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::set_linearthreshold(float val_in)
+{
+    design.params[thresholdparam] = val_in;
+    design.threshold = val_in;
+    design.linearthreshold = db2lin(val_in);
+    calculate_knee(design.knee);
 }
 
-void Compressor::set_attack(int sr_in, float attack_in)
+template <typename Sample>
+void BasicCompressor<Sample>::set_slope(float val_in)
 {
-    attacksamplesinv = 1.0f / ((float)sr_in * attack_in);
+    design.params[ratioparam] = 1.0f / val_in;
+    design.slope = val_in;
+    calculate_knee(design.knee);
 }
 
-void Compressor::set_release(int sr_in, float release_in)
+template <typename Sample>
+void BasicCompressor<Sample>::set_attack(int sr_in, float attack_in)
 {
+    attack = attack_in;
+    design.params[attackparam] = attack_in;
+    design.attacksamplesinv = 1.0f / ((float)sr_in * attack_in);
+    publish();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::set_release(int sr_in, float release_in)
+{
+    release = release_in;
+    design.params[releaseparam] = release_in;
     releasesamples = sr_in * release_in;
-    satreleasesamplesinv = 1.0f / ((float)sr_in * 0.0025f);
+    design.satreleasesamplesinv = 1.0f / ((float)sr_in * 0.0025f);
     calculate_releasecurve();
+    publish();
 }
 
-void Compressor::set_wetlevel(float wet_in)
+template <typename Sample>
+void BasicCompressor<Sample>::set_wetlevel(float wet_in)
 {
-    wet = wet_in;
-    dry = 1.0f - wet_in;
+    design.params[wetparam] = wet_in;
+    design.wet = wet_in;
+    design.dry = 1.0f - wet_in;
+    publish();
 }
 
-void Compressor::set_meterrelease(int sr_in)
+template <typename Sample>
+void BasicCompressor<Sample>::calculate_knee(float k_in)
 {
-    meterrelease = 1.0f - exp(-1.0f / ((float)sr_in * 0.325f));
+    design.knee = k_in;
+    design.params[kneeparam] = k_in;
+    design.params[postgainparam] = postgain;
+    const KneeSolution& solution = kneesolution(kneecache, design.threshold, design.knee, design.slope);
+    design.k = solution.k;
+    design.kneedboffset = solution.kneedboffset;
+    design.linearthresholdknee = solution.linearthresholdknee;
+    design.curvegain = solution.curvegain;
+    design.mastergain = db2lin(postgain) * design.curvegain;
+    if (design.fastmath)
+    {
+        calculate_curvetable();
+    }
+    publish();
+}
+
+template <typename Sample>
+const typename BasicCompressor<Sample>::KneeSolution& BasicCompressor<Sample>::kneesolution(KneeCache& cache,
+    float threshold, float knee, float slope)
+{
+    KneeSolution* solution = &cache.uncached;
+    if (slope > 1.0f / 1000000.0f)
+    {
+        int thresholdkey = (int)lroundf(threshold * SF_COMPRESSOR_KNEEDBSTEPS);
+        int kneekey = (int)lroundf(knee * SF_COMPRESSOR_KNEEDBSTEPS);
+        int ratiokey = (int)lroundf(SF_COMPRESSOR_KNEERATIOSTEPS / slope);
+        for (int i = 0; i < cache.size; i++)
+        {
+            const KneeSolution& entry = cache.entries[i];
+            if (entry.thresholdkey == thresholdkey && entry.kneekey == kneekey && entry.ratiokey == ratiokey)
+            {
+                return entry;
+            }
+        }
+        if (cache.size < SF_COMPRESSOR_KNEECACHESIZE)
+        {
+            solution = &cache.entries[cache.size++];
+        }
+        else
+        {
+            solution = &cache.entries[cache.next];
+            cache.next = (cache.next + 1) % SF_COMPRESSOR_KNEECACHESIZE;
+        }
+        solution->thresholdkey = thresholdkey;
+        solution->kneekey = kneekey;
+        solution->ratiokey = ratiokey;
+        // solve for the tuple the key stands for, so an entry does not depend on which value filled it
+        threshold = thresholdkey / (float)SF_COMPRESSOR_KNEEDBSTEPS;
+        knee = kneekey / (float)SF_COMPRESSOR_KNEEDBSTEPS;
+        slope = 1.0f / (ratiokey / (float)SF_COMPRESSOR_KNEERATIOSTEPS);
+    }
+    solveknee(threshold, knee, slope, *solution);
+    return *solution;
 }
 
-void Compressor::calculate_knee(float k_in)
+template <typename Sample>
+void BasicCompressor<Sample>::solveknee(float threshold, float knee, float slope, KneeSolution& solution)
 {
-    knee = k_in;
-    k = 5.0f;
-    kneedboffset = 0.0f;
-    linearthresholdknee = 0.0f;
+    float linearthreshold = db2lin(threshold);
+    float k = 5.0f;
+    float kneedboffset = 0.0f;
+    float linearthresholdknee = 0.0f;
     if (knee > 0.0f) { // if a knee exists, search for a good k value
         float xknee = db2lin(threshold + knee);
         float mink = 0.1f;
@@ -169,156 +417,1210 @@ void Compressor::calculate_knee(float k_in)
         kneedboffset = lin2db(kneecurve(xknee, k, linearthreshold));
         linearthresholdknee = db2lin(threshold + knee);
     }
-    // calculate a master gain based on what sounds good
-    float fulllevel = compcurve(1.0f, k, slope, linearthreshold, linearthresholdknee,
+    solution.k = k;
+    solution.kneedboffset = kneedboffset;
+    solution.linearthresholdknee = linearthresholdknee;
+    solution.fulllevel = compcurve(1.0f, k, slope, linearthreshold, linearthresholdknee,
         threshold, knee, kneedboffset);
-    mastergain = db2lin(postgain) * pow(1.0f / fulllevel, 0.6f);
+    // calculate a master gain based on what sounds good
+    solution.curvegain = pow(1.0f / solution.fulllevel, 0.6f);
+}
+
+template <typename Sample>
+float BasicCompressor<Sample>::getCurveAttenuation(float x) const
+{
+    if (design.fastmath)
+    {
+        return curveattenuation(design.curvetable, x, design.k, design.slope, design.linearthreshold,
+            design.linearthresholdknee, design.threshold, design.knee, design.kneedboffset);
+    }
+    return compcurve(x, design.k, design.slope, design.linearthreshold, design.linearthresholdknee,
+        design.threshold, design.knee, design.kneedboffset) / x;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::set_fastmath(bool enabled)
+{
+    design.fastmath = enabled;
+    if (design.fastmath)
+    {
+        calculate_curvetable();
+    }
+    publish();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::set_metering(bool enabled)
+{
+    design.metering = enabled;
+    publish();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::set_decimation(int factor)
+{
+    // round down to a power of two so the groups tile every full chunk
+    int decimation = 1;
+    while (decimation * 2 <= factor && decimation < SF_COMPRESSOR_MAXDECIMATION)
+    {
+        decimation *= 2;
+    }
+    design.decimation = decimation;
+    publish();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::set_link(LinkMode mode)
+{
+    design.linkmode = mode;
+    publish();
 }
 
-void Compressor::calculate_releasecurve()
+template <typename Sample>
+void BasicCompressor<Sample>::set_linkgroups(const int* groups, int count)
 {
-    float y1 = releasesamples * releasezone1;
-    float y2 = releasesamples * releasezone2;
-    float y3 = releasesamples * releasezone3;
-    float y4 = releasesamples * releasezone4;
+    jassert(count <= SF_COMPRESSOR_MAXCHANNELS);
+    for (int ch = 0; ch < count && ch < SF_COMPRESSOR_MAXCHANNELS; ch++)
+    {
+        jassert(groups[ch] >= 0 && groups[ch] < SF_COMPRESSOR_MAXCHANNELS);
+        design.linkgroups[ch] = juce::jlimit(0, SF_COMPRESSOR_MAXCHANNELS - 1, groups[ch]);
+    }
+    publish();
+}
+
+template <typename Sample>
+typename BasicCompressor<Sample>::EnvelopeState BasicCompressor<Sample>::getEnvelopeState() const
+{
+    EnvelopeState state;
+    state.numdetectors = numdetectors;
+    state.rmsfill = rmsfill;
+    for (int d = 0; d < numdetectors; d++)
+    {
+        const Detector& det = detectors[d];
+        state.detectors[d] = { det.detectoravg, det.compgain, det.maxcompdiffdb, det.premixgain, det.targetgain,
+            det.rmssum, det.rmsfresh };
+    }
+    return state;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::publish()
+{
+    select_kernel();
+    // the back buffer holds an older snapshot, so the whole design is copied over before the swap
+    exchange.getWriteBuffer() = design;
+    exchange.publish();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::acquire()
+{
+    if (!exchange.acquire())
+    {
+        return;
+    }
+    live = exchange.getReadBuffer();
+    liveisdesign = true;
+    // the link settings may have changed, the channels are mapped again before the next chunk
+    linkedchannels = 0;
+    // a set_* since the last snapshot wins over the events of that parameter, right away like every
+    // other setting. parameters only changed by events keep gliding on the new coefficients
+    bool kneeset = false;
+    for (int p = 0; p < numparameters; p++)
+    {
+        if (live.params[p] != snapshotparams[p])
+        {
+            snapshotparams[p] = live.params[p];
+            smoothers[p].current = live.params[p];
+            smoothers[p].target = live.params[p];
+            kneeset = kneeset || p == thresholdparam || p == kneeparam || p == ratioparam;
+        }
+    }
+    // the other two may still be off the snapshot, the glide they are on starts over from its curve
+    if (kneeset)
+    {
+        for (int p : { thresholdparam, kneeparam, ratioparam })
+        {
+            if (smoothers[p].target != live.params[p])
+            {
+                startKneeGlide();
+                break;
+            }
+        }
+    }
+    updateLive();
+    if (zerolatency && !cf->zerolatency)
+    {
+        // nothing was written while the ring was bypassed, so start over from silence at the new tap
+        memset(delaybuf, 0, (size_t)(delaymask + 1) * (size_t)delaychannels * sizeof(Sample));
+        delaysamples = cf->delaysamples;
+        delayfadeleft = 0;
+    }
+    zerolatency = cf->zerolatency;
+    if (!cf->metering)
+    {
+        // a consumer attached later starts with a fresh period
+        clearMeter();
+    }
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::select_kernel()
+{
+    design.chunkkernel = chooseKernel(design, true);
+}
+
+template <typename Sample>
+typename BasicCompressor<Sample>::ChunkKernel BasicCompressor<Sample>::chooseKernel(const Coefficients& c, bool usetable)
+{
+    bool unitypregain = c.linearpregain == 1.0f;
+    bool fullwet = c.wet == 1.0f && c.dry == 0.0f;
+    bool decimated = c.decimation > 1;
+    if (c.fastmath && usetable)
+    {
+        return kernelFor<tablecurve>(unitypregain, fullwet, c.metering, decimated);
+    }
+    else if (c.knee > 0.0f)
+    {
+        return kernelFor<softkneecurve>(unitypregain, fullwet, c.metering, decimated);
+    }
+    return kernelFor<hardkneecurve>(unitypregain, fullwet, c.metering, decimated);
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::startSmoothing(const ParameterEvent& event)
+{
+    jassert(event.parameter >= 0 && event.parameter < numparameters);
+    if (event.parameter < 0 || event.parameter >= numparameters)
+    {
+        return;
+    }
+    Smoother& s = smoothers[event.parameter];
+    s.target = event.value;
+    s.mode = event.glidesamples > 0 ? linearsmoothing : live.smoothingmode[event.parameter];
+    if (event.parameter == thresholdparam || event.parameter == kneeparam || event.parameter == ratioparam)
+    {
+        startKneeGlide();
+    }
+    float samples = event.glidesamples > 0 ? (float)event.glidesamples
+        : live.smoothingtime[event.parameter] * (float)live.samplerate;
+    if (samples < 1.0f)
+    {
+        s.current = s.target;
+        updateLive();
+        return;
+    }
+    if (s.mode == linearsmoothing)
+    {
+        s.samplesleft = (int)samples;
+        s.step = (s.target - s.current) / (float)s.samplesleft;
+    }
+    else
+    {
+        s.coefficient = exp(-1.0f / samples);
+    }
+    smoothing = true;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::startKneeGlide()
+{
+    kneefrom = { live.threshold, live.knee, live.slope, live.k, live.curvegain };
+    float threshold = smoothers[thresholdparam].target;
+    float knee = smoothers[kneeparam].target;
+    float slope = 1.0f / smoothers[ratioparam].target;
+    // automation sends a new target every block, so the solve runs once per step of the dials and
+    // the steps swept before come from the cache
+    const KneeSolution& solution = kneesolution(glidecache, threshold, knee, slope);
+    kneeto = { threshold, knee, slope, solution.k, solution.curvegain };
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::advanceSmoothing(int numsamples)
+{
+    smoothing = false;
+    for (int p = 0; p < numparameters; p++)
+    {
+        Smoother& s = smoothers[p];
+        if (s.current == s.target)
+        {
+            continue;
+        }
+        if (s.mode == linearsmoothing)
+        {
+            int n = numsamples < s.samplesleft ? numsamples : s.samplesleft;
+            s.samplesleft -= n;
+            s.current = s.samplesleft > 0 ? s.current + s.step * (float)n : s.target;
+        }
+        else
+        {
+            s.current = s.target + (s.current - s.target) * powi(s.coefficient, numsamples);
+            // close enough to be inaudible, land on the target so the smoother can stop
+            float scale = absf(s.target) > 1.0f ? absf(s.target) : 1.0f;
+            if (absf(s.current - s.target) <= 0.0001f * scale)
+            {
+                s.current = s.target;
+            }
+        }
+        smoothing = smoothing || s.current != s.target;
+    }
+    updateLive();
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::updateLive()
+{
+    const Coefficients& snapshot = exchange.getReadBuffer();
+    bool wasdesign = liveisdesign;
+    liveisdesign = true;
+    for (int p = 0; p < numparameters; p++)
+    {
+        liveisdesign = liveisdesign && smoothers[p].current == snapshot.params[p];
+    }
+    if (liveisdesign)
+    {
+        // back on the published values, which come with the cached knee and the curve table
+        if (!wasdesign)
+        {
+            live = snapshot;
+        }
+        return;
+    }
+
+    float* params = live.params;
+    float sr = (float)live.samplerate;
+    if (smoothers[pregainparam].current != params[pregainparam])
+    {
+        params[pregainparam] = smoothers[pregainparam].current;
+        live.linearpregain = db2lin(params[pregainparam]);
+    }
+    bool kneechanged = false;
+    for (int p : { thresholdparam, kneeparam, ratioparam })
+    {
+        kneechanged = kneechanged || smoothers[p].current != params[p];
+        params[p] = smoothers[p].current;
+    }
+    if (kneechanged)
+    {
+        live.threshold = params[thresholdparam];
+        live.linearthreshold = db2lin(live.threshold);
+        live.knee = params[kneeparam];
+        live.slope = 1.0f / params[ratioparam];
+        // the search for k only runs where a glide starts, see startKneeGlide. on the way k and the
+        // makeup gain are interpolated between the solutions at both ends, as far as the slowest of the
+        // three parameters has come, and the offset is worked out from k so the curve stays continuous
+        float current[3] = { live.threshold, live.knee, live.slope };
+        float from[3] = { kneefrom.threshold, kneefrom.knee, kneefrom.slope };
+        float to[3] = { kneeto.threshold, kneeto.knee, kneeto.slope };
+        float progress = 1.0f;
+        for (int i = 0; i < 3; i++)
+        {
+            if (to[i] != from[i])
+            {
+                float f = (current[i] - from[i]) / (to[i] - from[i]);
+                progress = f < progress ? f : progress;
+            }
+        }
+        progress = progress > 0.0f ? progress : 0.0f;
+        live.k = kneefrom.k + (kneeto.k - kneefrom.k) * progress;
+        live.curvegain = kneefrom.curvegain + (kneeto.curvegain - kneefrom.curvegain) * progress;
+        live.kneedboffset = 0.0f;
+        live.linearthresholdknee = 0.0f;
+        if (live.knee > 0.0f)
+        {
+            live.linearthresholdknee = db2lin(live.threshold + live.knee);
+            live.kneedboffset = lin2db(kneecurve(live.linearthresholdknee, live.k, live.linearthreshold));
+        }
+    }
+    if (kneechanged || smoothers[postgainparam].current != params[postgainparam])
+    {
+        params[postgainparam] = smoothers[postgainparam].current;
+        live.mastergain = db2lin(params[postgainparam]) * live.curvegain;
+    }
+    if (smoothers[attackparam].current != params[attackparam])
+    {
+        params[attackparam] = smoothers[attackparam].current;
+        live.attacksamplesinv = 1.0f / (sr * params[attackparam]);
+    }
+    if (smoothers[releaseparam].current != params[releaseparam])
+    {
+        params[releaseparam] = smoothers[releaseparam].current;
+        releasecurve(sr * params[releaseparam], live.releasezones[0], live.releasezones[1],
+            live.releasezones[2], live.releasezones[3], live.a, live.b, live.c, live.d);
+    }
+    if (smoothers[wetparam].current != params[wetparam])
+    {
+        params[wetparam] = smoothers[wetparam].current;
+        live.wet = params[wetparam];
+        live.dry = 1.0f - params[wetparam];
+    }
+    // the curve table belongs to the published curve, so off the published values the exact curve is used
+    live.chunkkernel = chooseKernel(live, false);
+}
+
+template <typename Sample>
+template <int Curve>
+typename BasicCompressor<Sample>::ChunkKernel BasicCompressor<Sample>::kernelFor(bool unitypregain, bool fullwet, bool metering, bool decimated)
+{
+    return unitypregain ? kernelFor<Curve, true>(fullwet, metering, decimated)
+        : kernelFor<Curve, false>(fullwet, metering, decimated);
+}
+
+template <typename Sample>
+template <int Curve, bool UnityPregain>
+typename BasicCompressor<Sample>::ChunkKernel BasicCompressor<Sample>::kernelFor(bool fullwet, bool metering, bool decimated)
+{
+    return fullwet ? kernelFor<Curve, UnityPregain, true>(metering, decimated)
+        : kernelFor<Curve, UnityPregain, false>(metering, decimated);
+}
+
+template <typename Sample>
+template <int Curve, bool UnityPregain, bool FullWet>
+typename BasicCompressor<Sample>::ChunkKernel BasicCompressor<Sample>::kernelFor(bool metering, bool decimated)
+{
+    if (decimated)
+    {
+        return metering ? &BasicCompressor::processDecimatedChunk<Curve, UnityPregain, FullWet, true>
+            : &BasicCompressor::processDecimatedChunk<Curve, UnityPregain, FullWet, false>;
+    }
+    return metering ? &BasicCompressor::processChunk<Curve, UnityPregain, FullWet, true>
+        : &BasicCompressor::processChunk<Curve, UnityPregain, FullWet, false>;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::calculate_curvetable()
+{
+    // one point per table step, spaced the same way the float bits are indexed in curveattenuation
+    for (int i = 0; i < SF_COMPRESSOR_CURVETABLESIZE; i++)
+    {
+        uint32_t bits = ((uint32_t)(127 + SF_COMPRESSOR_CURVEMINEXP) << 23)
+            + ((uint32_t)i << (23 - SF_COMPRESSOR_CURVESTEPBITS));
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        design.curvetable[i] = compcurve(x, design.k, design.slope, design.linearthreshold, design.linearthresholdknee,
+            design.threshold, design.knee, design.kneedboffset) / x;
+    }
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::calculate_releasecurve()
+{
+    design.releasezones[0] = releasezone1;
+    design.releasezones[1] = releasezone2;
+    design.releasezones[2] = releasezone3;
+    design.releasezones[3] = releasezone4;
+    releasecurve(releasesamples, releasezone1, releasezone2, releasezone3, releasezone4,
+        design.a, design.b, design.c, design.d);
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::releasecurve(float releasesamples, float zone1, float zone2, float zone3, float zone4,
+    float& a, float& b, float& c, float& d)
+{
+    float y1 = releasesamples * zone1;
+    float y2 = releasesamples * zone2;
+    float y3 = releasesamples * zone3;
+    float y4 = releasesamples * zone4;
     a = (-y1 + 3.0f * y2 - 3.0f * y3 + y4) / 6.0f;
     b = y1 - 2.5f * y2 + 2.0f * y3 - 0.5f * y4;
     c = (-11.0f * y1 + 18.0f * y2 - 9.0f * y3 + 2.0f * y4) / 6.0f;
     d = y1;
 }
 
-void Compressor::processBuffer(juce::AudioBuffer<float>& buffer)
+template <typename Sample>
+void BasicCompressor<Sample>::processBuffer(juce::AudioBuffer<Sample>& buffer)
+{
+    processBuffer(buffer.getArrayOfReadPointers(), buffer.getArrayOfWritePointers(),
+        buffer.getNumChannels(), buffer.getNumSamples());
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::processBuffer(const Sample* const* inputs, Sample* const* outputs, int inputchannels, int numsamples)
+{
+    processBuffer(inputs, outputs, inputchannels, numsamples, nullptr, 0);
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::processBuffer(const Sample* const* inputs, Sample* const* outputs, int inputchannels, int numsamples,
+    const ParameterEvent* events, int numevents)
+{
+    // channels past the ones given to prepare have no room in the ring and are left untouched
+    jassert(inputchannels <= delaychannels);
+    if (inputchannels > delaychannels)
+    {
+        inputchannels = delaychannels;
+    }
+    if (numsamples <= 0 || inputchannels <= 0)
+    {
+        return;
+    }
+    numchannels = inputchannels;
+    sidechain = nullptr;
+    numsidechain = 0;
+    processChunks(inputs, outputs, numsamples, events, numevents);
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::processSidechain(const Sample* const* inputs, Sample* const* outputs, int inputchannels,
+    int numsamples, const Sample* const* key, int numkeychannels, const ParameterEvent* events, int numevents)
+{
+    jassert(inputchannels <= delaychannels && numkeychannels <= SF_COMPRESSOR_MAXCHANNELS);
+    if (inputchannels > delaychannels)
+    {
+        inputchannels = delaychannels;
+    }
+    if (numsamples <= 0 || inputchannels <= 0)
+    {
+        return;
+    }
+    numchannels = inputchannels;
+    // without a key the detectors go back to the input
+    sidechain = numkeychannels > 0 ? key : nullptr;
+    numsidechain = numkeychannels < SF_COMPRESSOR_MAXCHANNELS ? numkeychannels : SF_COMPRESSOR_MAXCHANNELS;
+    processChunks(inputs, outputs, numsamples, events, numevents);
+    sidechain = nullptr;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::computeGain(const Sample* const* key, int numkeychannels, Sample* gain, int numsamples,
+    const ParameterEvent* events, int numevents)
 {
-    auto* lReadWritePointer = buffer.getWritePointer(0);
-    auto* rReadWritePointer = buffer.getWritePointer(1);
-    size = buffer.getNumSamples();
-    int samplesperchunk = SF_COMPRESSOR_SPU;
-    if (samplesperchunk > size)
+    // no ring is involved, so the key is only limited by the detectors
+    jassert(numkeychannels <= SF_COMPRESSOR_MAXCHANNELS);
+    if (numkeychannels > SF_COMPRESSOR_MAXCHANNELS)
+    {
+        numkeychannels = SF_COMPRESSOR_MAXCHANNELS;
+    }
+    if (numsamples <= 0 || numkeychannels <= 0)
     {
-        samplesperchunk = size;
+        return;
+    }
+    // the key channels take the place of the input channels, so they are linked like them
+    numchannels = numkeychannels;
+    sidechain = key;
+    numsidechain = numkeychannels;
+    gaincurve = gain;
+    processChunks(nullptr, nullptr, numsamples, events, numevents);
+    sidechain = nullptr;
+    gaincurve = nullptr;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::applyGain(const Sample* gain, const Sample* const* inputs, Sample* const* outputs,
+    int numchannels, int numsamples)
+{
+    for (int ch = 0; ch < numchannels; ch++) {
+        const Sample* inptr = inputs[ch];
+        Sample* outptr = outputs[ch];
+        for (int i = 0; i < numsamples; i++) {
+            outptr[i] = inptr[i] * gain[i];
+        }
+    }
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::processChunks(const Sample* const* inputs, Sample* const* outputs, int numsamples,
+    const ParameterEvent* events, int numevents)
+{
+    size = numsamples;
+
+    // pick up the latest settings at the block boundary, never waits on the message thread
+    acquire();
+    if (cf->oversampling != keyoversampler.getFactor()) {
+        keyoversampler.set_factor(cf->oversampling);
+    }
+    if (cf->rmswindow != rmswindow) {
+        resizeWindow();
+    }
+    if (numchannels != linkedchannels) {
+        linkChannels();
     }
-    int chunks = size / samplesperchunk;
-    int remainder = size - (chunks * samplesperchunk);
     samplepos = 0;
+    int nextevent = 0;
+
+    // the chunk grid runs on from the previous call, so a chunk cut by the end of a buffer is finished
+    // by the next one. the envelope rate, smoothing and events only change at chunk boundaries, which
+    // makes the output the same for any split of the input into buffers
+    while (samplepos < size) {
+        if (chunkphase == 0) {
+            applyEvents(events, numevents, nextevent);
+            calculateEnvelopeRate();
+        }
+        int numchunk = SF_COMPRESSOR_SPU - chunkphase;
+        if (numchunk > size - samplepos) {
+            numchunk = size - samplepos;
+        }
+        (this->*cf->chunkkernel)(inputs, outputs, numchunk);
+        samplepos += numchunk;
+        chunkphase = (chunkphase + numchunk) & (SF_COMPRESSOR_SPU - 1);
+        if (chunkphase == 0 && smoothing) {
+            advanceSmoothing(SF_COMPRESSOR_SPU);
+        }
+    }
+    // events after the last boundary of the buffer wait for the next one, only the latest of a
+    // parameter matters there
+    for (; nextevent < numevents; nextevent++) {
+        const ParameterEvent& event = events[nextevent];
+        if (event.parameter >= 0 && event.parameter < numparameters) {
+            pendingevents[event.parameter] = event;
+            pending[event.parameter] = true;
+        }
+    }
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::applyEvents(const ParameterEvent* events, int numevents, int& nextevent)
+{
+    // held over from the previous buffer, so they come first
+    for (int p = 0; p < numparameters; p++) {
+        if (pending[p]) {
+            pending[p] = false;
+            startSmoothing(pendingevents[p]);
+        }
+    }
+    while (nextevent < numevents && events[nextevent].sampleoffset <= samplepos) {
+        startSmoothing(events[nextevent++]);
+    }
+}
 
-    for (int ch = 0; ch < chunks; ch++) {
-        detectoravg = fixf(detectoravg, 1.0f);
-        float desiredgain = detectoravg;
-        scaleddesiredgain = asin(desiredgain) * ang90inv;
-        float compdiffdb = lin2db(compgain / scaleddesiredgain);
+template <typename Sample>
+void BasicCompressor<Sample>::linkChannels()
+{
+    // detectors are handed out in the order the groups first appear, so they stay packed
+    int groupdetector[SF_COMPRESSOR_MAXCHANNELS];
+    int channelcount[SF_COMPRESSOR_MAXCHANNELS] = {};
+    int mapping[SF_COMPRESSOR_MAXCHANNELS];
+    int count = 0;
+    for (int g = 0; g < SF_COMPRESSOR_MAXCHANNELS; g++) {
+        groupdetector[g] = -1;
+    }
+    for (int ch = 0; ch < numchannels; ch++) {
+        int group = cf->linkmode == independentlink ? ch : cf->linkgroups[ch];
+        if (groupdetector[group] < 0) {
+            groupdetector[group] = count++;
+        }
+        mapping[ch] = groupdetector[group];
+        channelcount[mapping[ch]]++;
+    }
+
+    // a new grouping restarts every detector from the one that was reducing the most, so relinking
+    // never lets a peak through
+    if (count != numdetectors || memcmp(mapping, channeldetector, (size_t)numchannels * sizeof(int)) != 0) {
+        int seed = 0;
+        for (int d = 1; d < numdetectors; d++) {
+            seed = detectors[d].compgain < detectors[seed].compgain ? d : seed;
+        }
+        // the RMS window goes with the rest of the detector
+        if (rmswindow > 0 && seed < rmsrows) {
+            const Sample* seedrow = rmsbuf + (size_t)seed * (size_t)(rmsmask + 1);
+            for (int d = 0; d < count && d < rmsrows; d++) {
+                if (d != seed) {
+                    memcpy(rmsbuf + (size_t)d * (size_t)(rmsmask + 1), seedrow, (size_t)(rmsmask + 1) * sizeof(Sample));
+                }
+            }
+        }
+        Detector seedstate = detectors[seed];
+        for (int d = 0; d < count; d++) {
+            detectors[d] = seedstate;
+        }
+        memcpy(channeldetector, mapping, (size_t)numchannels * sizeof(int));
+        numdetectors = count;
+    }
+    for (int d = 0; d < numdetectors; d++) {
+        detectorscale[d] = (Sample)1.0f / (Sample)channelcount[d];
+    }
+    linkedchannels = numchannels;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::resizeWindow()
+{
+    // the rows are only written while a window is in use, after the peak detector they are stale
+    if (rmswindow == 0) {
+        memset(rmsbuf, 0, (size_t)(rmsmask + 1) * (size_t)rmsrows * sizeof(Sample));
+    }
+    rmswindow = cf->rmswindow;
+    // the rows hold more history than any window, so a new length is summed from them once
+    for (int d = 0; d < rmsrows && d < SF_COMPRESSOR_MAXCHANNELS; d++) {
+        const Sample* row = rmsbuf + (size_t)d * (size_t)(rmsmask + 1);
+        Sample sum = 0.0f;
+        for (int i = 1; i <= rmswindow; i++) {
+            sum += row[(rmswritepos - i) & rmsmask];
+        }
+        detectors[d].rmssum = sum;
+        detectors[d].rmsfresh = 0.0f;
+    }
+    rmsfill = 0;
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::calculateEnvelopeRate()
+{
+    for (int d = 0; d < numdetectors; d++) {
+        Detector& det = detectors[d];
+        det.detectoravg = fixf(det.detectoravg, 1.0f);
+        Sample desiredgain = det.detectoravg;
+        det.scaleddesiredgain = asin(desiredgain) * ang90inv;
+        Sample compdiffdb = lin2db(det.compgain / det.scaleddesiredgain);
 
         // calculate envelope rate based on whether we're attacking or releasing
         if (compdiffdb < 0.0f) { // compgain < scaleddesiredgain, so we're releasing
             compdiffdb = fixf(compdiffdb, -1.0f);
-            maxcompdiffdb = -1; // reset for a future attack mode
+            det.maxcompdiffdb = -1; // reset for a future attack mode
             // apply the adaptive release curve
             // scale compdiffdb between 0-3
-            float x = (clampf(compdiffdb, -12.0f, 0.0f) + 12.0f) * 0.25f;
-            float releasesamples = adaptivereleasecurve(x, a, b, c, d);
-            enveloperate = db2lin(SF_COMPRESSOR_SPACINGDB / releasesamples);
+            Sample x = (clampf(compdiffdb, -12.0f, 0.0f) + 12.0f) * 0.25f;
+            Sample releasesamples = adaptivereleasecurve(x, cf->a, cf->b, cf->c, cf->d);
+            det.enveloperate = db2lin(SF_COMPRESSOR_SPACINGDB / releasesamples);
         }
         else { // compresorgain > scaleddesiredgain, so we're attacking
             compdiffdb = fixf(compdiffdb, 1.0f);
-            if (maxcompdiffdb == -1 || maxcompdiffdb < compdiffdb) {
-                maxcompdiffdb = compdiffdb;
+            if (det.maxcompdiffdb == -1 || det.maxcompdiffdb < compdiffdb) {
+                det.maxcompdiffdb = compdiffdb;
             }
-            float attenuate = maxcompdiffdb;
+            Sample attenuate = det.maxcompdiffdb;
             if (attenuate < 0.5f) {
                 attenuate = 0.5f;
             }
-            enveloperate = 1.0f - pow(0.25f / attenuate, attacksamplesinv);
+            det.enveloperate = 1.0f - pow(0.25f / attenuate, cf->attacksamplesinv);
+        }
+    }
+}
+
+template <typename Sample>
+template <int Curve, bool UnityPregain, bool FullWet, bool Metering>
+void BasicCompressor<Sample>::processChunk(const Sample* const* inputs, Sample* const* outputs, int numsamples)
+{
+    detectorPass<Curve, UnityPregain>(inputs, numsamples);
+    envelopePass(numsamples);
+    gainLawPass(numsamples);
+    gainPass<FullWet, Metering>(outputs, numsamples);
+}
+
+// control rate version of the three passes, see set_decimation
+template <typename Sample>
+template <int Curve, bool UnityPregain, bool FullWet, bool Metering>
+void BasicCompressor<Sample>::processDecimatedChunk(const Sample* const* inputs, Sample* const* outputs, int numsamples)
+{
+    inputPass<UnityPregain>(inputs, numsamples);
+    if (rmswindow > 0) {
+        windowPass(numsamples);
+    }
+    decimatedEnvelopePass<Curve>(numsamples);
+    gainPass<FullWet, Metering>(outputs, numsamples);
+}
+
+// pass 1: stateless per-sample work, pregain, the linked level of each detector and the static curve.
+// the whole chunk is read here before pass 3 writes anything, so in-place processing is safe
+template <typename Sample>
+template <int Curve, bool UnityPregain>
+void BasicCompressor<Sample>::detectorPass(const Sample* const* inputs, int numsamples)
+{
+    inputPass<UnityPregain>(inputs, numsamples);
+    if (rmswindow > 0) {
+        windowPass(numsamples);
+    }
+    for (int d = 0; d < numdetectors; d++) {
+        for (int i = 0; i < numsamples; i++) {
+            attenuationbuf[d][i] = curveAttenuation<Curve>(levelbuf[d][i]);
+        }
+    }
+}
+
+template <typename Sample>
+template <bool UnityPregain>
+void BasicCompressor<Sample>::inputPass(const Sample* const* inputs, int numsamples)
+{
+    // computeGain has no input, only the key
+    if (inputs != nullptr) {
+        for (int ch = 0; ch < numchannels; ch++) {
+            const Sample* inptr = inputs[ch] + samplepos;
+            if (UnityPregain) {
+                memcpy(prebuf[ch], inptr, (size_t)numsamples * sizeof(Sample));
+            }
+            else {
+                for (int i = 0; i < numsamples; i++) {
+                    prebuf[ch][i] = inptr[i] * cf->linearpregain;
+                }
+            }
         }
-        // process the chunk
-        for (int chi = 0; chi < samplesperchunk; chi++) {
-            perSampleProcessing(buffer, lReadWritePointer, rReadWritePointer);
-            samplepos++;
-            delayreadpos++;
-            delaywritepos++;
+    }
+
+    // the cross-channel reduction runs a channel at a time over the whole chunk, so every inner
+    // loop is a plain vector operation whatever the channel count
+    LinkMode linkmode = cf->linkmode;
+    for (int d = 0; d < numdetectors; d++) {
+        memset(levelbuf[d], 0, (size_t)numsamples * sizeof(Sample));
+    }
+    if (sidechain == nullptr) {
+        for (int ch = 0; ch < numchannels; ch++) {
+            accumulateLevel<false>(levelbuf[channeldetector[ch]], detectorInput(ch, prebuf[ch], numsamples), 1.0f,
+                linkmode, numsamples);
         }
     }
-    // process any remaining samples that dont fit in a chunk
-    for (int chi = 0; chi < remainder; chi++) {
-        perSampleProcessing(buffer, lReadWritePointer, rReadWritePointer);
-        samplepos++;
-        delayreadpos++;
-        delaywritepos++;
+    else if (numsidechain == numchannels) {
+        for (int ch = 0; ch < numchannels; ch++) {
+            accumulateLevel<!UnityPregain>(levelbuf[channeldetector[ch]],
+                detectorInput(ch, sidechain[ch] + samplepos, numsamples), cf->linearpregain, linkmode, numsamples);
+        }
+    }
+    else {
+        // a key that does not match the input is linked across all of its channels, for every detector
+        for (int ch = 0; ch < numsidechain; ch++) {
+            accumulateLevel<!UnityPregain>(levelbuf[0], detectorInput(ch, sidechain[ch] + samplepos, numsamples),
+                cf->linearpregain, linkmode, numsamples);
+        }
+        finishLevel(levelbuf[0], (Sample)1.0f / (Sample)numsidechain, linkmode, numsamples);
+        for (int d = 1; d < numdetectors; d++) {
+            memcpy(levelbuf[d], levelbuf[0], (size_t)numsamples * sizeof(Sample));
+        }
+        return;
+    }
+    for (int d = 0; d < numdetectors; d++) {
+        finishLevel(levelbuf[d], detectorscale[d], linkmode, numsamples);
     }
 }
 
-void Compressor::perSampleProcessing(juce::AudioBuffer<float>& buffer, float* lptr, float* rptr)
+// the largest magnitude of the factor upsampled values of each sample, never below the sample itself
+// by more than the passband ripple. all link modes take it in place of the sample
+template <typename Sample>
+const Sample* BasicCompressor<Sample>::detectorInput(int channel, const Sample* input, int numsamples)
 {
-    while (delaywritepos >= delaybufsize)
-    {
-        delaywritepos -= delaybufsize;
+    int factor = keyoversampler.getFactor();
+    if (factor == 1) {
+        return input;
     }
-    while (delayreadpos >= delaybufsize)
-    {
-        delayreadpos -= delaybufsize;
+    keyoversampler.upsample(channel, input, upbuf, numsamples);
+    for (int i = 0; i < numsamples; i++) {
+        const Sample* period = upbuf + i * factor;
+        Sample peak = absf(period[0]);
+        for (int j = 1; j < factor; j++) {
+            Sample value = absf(period[j]);
+            peak = value > peak ? value : peak;
+        }
+        peakbuf[i] = peak;
     }
+    return peakbuf;
+}
 
-    float inputL = buffer.getSample(0, samplepos) * linearpregain; // these change from the original code due to reading from the JUCE buffer
-    float inputR = buffer.getSample(1, samplepos) * linearpregain;
+template <typename Sample>
+template <bool Scaled>
+void BasicCompressor<Sample>::accumulateLevel(Sample* level, const Sample* channel, Sample gain, LinkMode linkmode,
+    int numsamples)
+{
+    if (linkmode == meanlink) {
+        for (int i = 0; i < numsamples; i++) {
+            level[i] += absf(Scaled ? channel[i] * gain : channel[i]);
+        }
+    }
+    else if (linkmode == rmslink) {
+        for (int i = 0; i < numsamples; i++) {
+            Sample input = Scaled ? channel[i] * gain : channel[i];
+            level[i] += input * input;
+        }
+    }
+    else {
+        for (int i = 0; i < numsamples; i++) {
+            Sample input = absf(Scaled ? channel[i] * gain : channel[i]);
+            level[i] = input > level[i] ? input : level[i];
+        }
+    }
+}
 
-    delaybufL[delaywritepos] = inputL;
-    delaybufR[delaywritepos] = inputR;
+// the mean and RMS levels are sums until here, the peak is done already
+template <typename Sample>
+void BasicCompressor<Sample>::finishLevel(Sample* level, Sample scale, LinkMode linkmode, int numsamples)
+{
+    if (linkmode == meanlink) {
+        for (int i = 0; i < numsamples; i++) {
+            level[i] *= scale;
+        }
+    }
+    else if (linkmode == rmslink) {
+        for (int i = 0; i < numsamples; i++) {
+            level[i] = sqrt(level[i] * scale);
+        }
+    }
+}
 
-    inputL = absf(inputL);
-    inputR = absf(inputR);
-    float inputmax = inputL > inputR ? inputL : inputR;
+// the linked level of each detector as the root mean square over the window. the running sum adds
+// the square that enters the window and subtracts the one that leaves it, whatever the window length.
+// the subtractions leave rounding errors behind that would add up forever, so a fresh sum of only
+// additions runs alongside and takes over whenever it covers exactly one window
+template <typename Sample>
+void BasicCompressor<Sample>::windowPass(int numsamples)
+{
+    int window = rmswindow;
+    int mask = rmsmask;
+    Sample windowinv = (Sample)1.0f / (Sample)window;
+    int rows = numdetectors < rmsrows ? numdetectors : rmsrows;
+    for (int start = 0; start < numsamples;) {
+        int run = numsamples - start < window - rmsfill ? numsamples - start : window - rmsfill;
+        for (int d = 0; d < rows; d++) {
+            Detector& det = detectors[d];
+            Sample* row = rmsbuf + (size_t)d * (size_t)(mask + 1);
+            Sample* level = levelbuf[d] + start;
+            Sample sum = det.rmssum;
+            Sample fresh = det.rmsfresh;
+            int pos = rmswritepos;
+            for (int i = 0; i < run; i++) {
+                Sample square = level[i] * level[i];
+                // the square leaving is read before the one entering is written, for a window of the full row
+                sum += square - row[(pos - window) & mask];
+                fresh += square;
+                row[pos] = square;
+                pos = (pos + 1) & mask;
+                level[i] = sqrt((sum > 0.0f ? sum : (Sample)0.0f) * windowinv);
+            }
+            det.rmssum = sum;
+            det.rmsfresh = fresh;
+        }
+        rmswritepos = (rmswritepos + run) & mask;
+        rmsfill += run;
+        start += run;
+        if (rmsfill == window) {
+            for (int d = 0; d < rows; d++) {
+                detectors[d].rmssum = detectors[d].rmsfresh;
+                detectors[d].rmsfresh = 0.0f;
+            }
+            rmsfill = 0;
+        }
+    }
+}
 
-    float attenuation;
+// same branches as compcurve, minus the ones this kernel can never take
+template <typename Sample>
+template <int Curve>
+inline Sample BasicCompressor<Sample>::curveAttenuation(Sample inputmax)
+{
     if (inputmax < 0.0001f) {
-        attenuation = 1.0f;
+        return 1.0f;
     }
-    else {
-        float inputcomp = compcurve(inputmax, k, slope, linearthreshold,
-            linearthresholdknee, threshold, knee, kneedboffset);
-        attenuation = inputcomp / inputmax;
+    else if (Curve == tablecurve) {
+        return curveattenuation(cf->curvetable, (float)inputmax, cf->k, cf->slope, cf->linearthreshold,
+            cf->linearthresholdknee, cf->threshold, cf->knee, cf->kneedboffset);
+    }
+    else if (inputmax < cf->linearthreshold) {
+        return 1.0f;
     }
+    else if (Curve == hardkneecurve) {
+        return db2lin(cf->threshold + cf->slope * (lin2db(inputmax) - cf->threshold)) / inputmax;
+    }
+    else if (inputmax < cf->linearthresholdknee) {
+        return kneecurve(inputmax, cf->k, cf->linearthreshold) / inputmax;
+    }
+    return db2lin(cf->kneedboffset + cf->slope * (lin2db(inputmax) - cf->threshold - cf->knee)) / inputmax;
+}
+
+// pass 2: the detector and envelope recurrence, the only part that has to run sample by sample.
+// each detector runs on its own, the state is kept in locals for the length of the chunk
+template <typename Sample>
+void BasicCompressor<Sample>::envelopePass(int numsamples)
+{
+    for (int d = 0; d < numdetectors; d++) {
+        Detector& det = detectors[d];
+        const Sample* attenuationptr = attenuationbuf[d];
+        Sample* gainptr = gainbuf[d];
+
+        Sample detectoravg = det.detectoravg;
+        for (int i = 0; i < numsamples; i++) {
+            Sample attenuation = attenuationptr[i];
+            Sample rate;
+            if (attenuation > detectoravg) { // if releasing
+                Sample attenuationdb = -lin2db(attenuation);
+                if (attenuationdb < 2.0f) {
+                    attenuationdb = 2.0f;
+                }
+                Sample dbpersample = attenuationdb * cf->satreleasesamplesinv;
+                rate = db2lin(dbpersample) - 1.0f;
+            }
+            else {
+                rate = 1.0f;
+            }
+
+            detectoravg += (attenuation - detectoravg) * rate;
+            if (detectoravg > 1.0f) {
+                detectoravg = 1.0f;
+            }
+            detectoravg = fixf(detectoravg, 1.0f);
+        }
+        det.detectoravg = detectoravg;
 
-    float rate;
-    if (attenuation > detectoravg) { // if releasing
-        float attenuationdb = -lin2db(attenuation);
-        if (attenuationdb < 2.0f) {
-            attenuationdb = 2.0f;
+        // enveloperate only changes between chunks, so the direction is picked once per chunk
+        Sample compgain = det.compgain;
+        Sample enveloperate = det.enveloperate;
+        if (enveloperate < 1) { // attack, reduce gain
+            Sample scaleddesiredgain = det.scaleddesiredgain;
+            for (int i = 0; i < numsamples; i++) {
+                compgain += (scaleddesiredgain - compgain) * enveloperate;
+                gainptr[i] = compgain;
+            }
+        }
+        else { // release, increase gain
+            for (int i = 0; i < numsamples; i++) {
+                compgain *= enveloperate;
+                if (compgain > 1.0f) {
+                    compgain = 1.0f;
+                }
+                gainptr[i] = compgain;
+            }
         }
-        float dbpersample = attenuationdb * satreleasesamplesinv;
-        rate = db2lin(dbpersample) - 1.0f;
+        det.compgain = compgain;
     }
-    else {
-        rate = 1.0f;
+}
+
+// the decimated detector and envelope. the peak of each group of cf->decimation samples goes through
+// the static curve once, and the detector and envelope recurrences are stepped over the whole group in
+// closed form. the gain after the gain law is interpolated linearly over the next group, so each sample
+// only depends on earlier ones. groups sit on the chunk grid and, like the chunks, a group that a
+// buffer ends inside carries its peak so far over to the next buffer
+template <typename Sample>
+template <int Curve>
+void BasicCompressor<Sample>::decimatedEnvelopePass(int numsamples)
+{
+    int decimation = cf->decimation;
+    Sample decimationinv = (Sample)1.0f / (Sample)decimation;
+    for (int d = 0; d < numdetectors; d++) {
+        Detector& det = detectors[d];
+        const Sample* level = levelbuf[d];
+        Sample* gainptr = gainbuf[d];
+        int phase = chunkphase & (decimation - 1);
+        for (int start = 0; start < numsamples;) {
+            int run = numsamples - start < decimation - phase ? numsamples - start : decimation - phase;
+            Sample inputmax = phase == 0 ? level[start] : det.groupmax;
+            Sample step = (det.targetgain - det.premixgain) * decimationinv;
+            for (int i = 0; i < run; i++) {
+                inputmax = level[start + i] > inputmax ? level[start + i] : inputmax;
+                gainptr[start + i] = det.premixgain + step * (Sample)(phase + i + 1);
+            }
+            det.groupmax = inputmax;
+            start += run;
+            phase += run;
+            if (phase < decimation) {
+                break;
+            }
+            phase = 0;
+
+            // the level is held for the whole group, so decimation steps of the detector collapse into one
+            Sample attenuation = curveAttenuation<Curve>(inputmax);
+            if (attenuation > det.detectoravg) { // if releasing
+                Sample attenuationdb = -lin2db(attenuation);
+                if (attenuationdb < 2.0f) {
+                    attenuationdb = 2.0f;
+                }
+                Sample dbpersample = attenuationdb * cf->satreleasesamplesinv;
+                Sample rate = db2lin(dbpersample) - 1.0f;
+                det.detectoravg = attenuation + (det.detectoravg - attenuation) * powi(1.0f - rate, decimation);
+            }
+            else {
+                det.detectoravg = attenuation;
+            }
+            if (det.detectoravg > 1.0f) {
+                det.detectoravg = 1.0f;
+            }
+            det.detectoravg = fixf(det.detectoravg, 1.0f);
+
+            if (det.enveloperate < 1) { // attack, reduce gain
+                det.compgain = det.scaleddesiredgain
+                    + (det.compgain - det.scaleddesiredgain) * powi(1.0f - det.enveloperate, decimation);
+            }
+            else { // release, increase gain
+                det.compgain *= powi(det.enveloperate, decimation);
+                if (det.compgain > 1.0f) {
+                    det.compgain = 1.0f;
+                }
+            }
+
+            // the ramp of the next group ends on the gain this one leads to
+            det.premixgain = det.targetgain;
+            det.targetgain = sin(ang90 * det.compgain);
+        }
     }
+}
 
-    detectoravg += (attenuation - detectoravg) * rate;
-    if (detectoravg > 1.0f) {
-        detectoravg = 1.0f;
+// the final gain value!
+template <typename Sample>
+void BasicCompressor<Sample>::gainLawPass(int numsamples)
+{
+    for (int d = 0; d < numdetectors; d++) {
+        Sample* gainptr = gainbuf[d];
+        for (int i = 0; i < numsamples; i++) {
+            gainptr[i] = sin(ang90 * gainptr[i]);
+        }
+        // the decimated kernel interpolates from here when the control rate is switched
+        detectors[d].premixgain = gainptr[numsamples - 1];
+        detectors[d].targetgain = gainptr[numsamples - 1];
     }
-    detectoravg = fixf(detectoravg, 1.0f);
+}
 
-    if (enveloperate < 1) { // attack, reduce gain
-        compgain += (scaleddesiredgain - compgain) * enveloperate;
+// pass 3: wet/dry mix, metering and the delayed output
+template <typename Sample>
+template <bool FullWet, bool Metering>
+void BasicCompressor<Sample>::gainPass(Sample* const* outputs, int numsamples)
+{
+    // the input side of the meter needs the gain before it is mixed. computeGain has no input to meter
+    if (Metering && gaincurve == nullptr) {
+        meterInput(numsamples);
     }
-    else { // release, increase gain
-        compgain *= enveloperate;
-        if (compgain > 1.0f) {
-            compgain = 1.0f;
+
+    for (int d = 0; d < numdetectors; d++) {
+        Sample* gainptr = gainbuf[d];
+        if (FullWet) {
+            for (int i = 0; i < numsamples; i++) {
+                gainptr[i] = cf->mastergain * gainptr[i];
+            }
+        }
+        else {
+            for (int i = 0; i < numsamples; i++) {
+                gainptr[i] = cf->dry + cf->wet * cf->mastergain * gainptr[i];
+            }
         }
     }
 
-    // the final gain value!
-    float premixgain = sin(ang90 * compgain);
-    float gain = dry + wet * mastergain * premixgain;
+    if (gaincurve != nullptr) {
+        curvePass(numsamples);
+        return;
+    }
+    outputPass(outputs, numsamples);
+    if (Metering) {
+        meterOutput(outputs, numsamples);
+    }
+}
 
-    // calculate metering (not used in core algo, but used to output a meter if desired)
-    float premixgaindb = lin2db(premixgain);
-    if (premixgaindb < metergain) {
-        metergain = premixgaindb; // spike immediately
+// the gain of computeGain, with the pregain the output pass would have applied to the input
+template <typename Sample>
+void BasicCompressor<Sample>::curvePass(int numsamples)
+{
+    Sample* curve = gaincurve + samplepos;
+    memcpy(curve, gainbuf[0], (size_t)numsamples * sizeof(Sample));
+    for (int d = 1; d < numdetectors; d++) {
+        const Sample* gainptr = gainbuf[d];
+        for (int i = 0; i < numsamples; i++) {
+            curve[i] = gainptr[i] < curve[i] ? gainptr[i] : curve[i];
+        }
     }
-    else {
-        metergain += (premixgaindb - metergain) * meterrelease; // fall slowly
+    if (cf->linearpregain != 1.0f) {
+        for (int i = 0; i < numsamples; i++) {
+            curve[i] *= cf->linearpregain;
+        }
     }
+}
+
+// the gain applied to the delayed input, or to the input itself in zero latency mode
+template <typename Sample>
+void BasicCompressor<Sample>::outputPass(Sample* const* outputs, int numsamples)
+{
+    if (zerolatency) {
+        for (int ch = 0; ch < numchannels; ch++) {
+            Sample* outptr = outputs[ch] + samplepos;
+            const Sample* gainptr = gainbuf[channeldetector[ch]];
+            for (int i = 0; i < numsamples; i++) {
+                outptr[i] = prebuf[ch][i] * gainptr[i];
+            }
+        }
+        return;
+    }
+
+    // a predelay change never touches the ring contents, it starts a crossfade to the new read tap.
+    // a change that arrives during a crossfade waits for it to finish
+    if (delayfadeleft == 0 && cf->delaysamples != delaysamples) {
+        fadedelaysamples = delaysamples;
+        delaysamples = cf->delaysamples;
+        delayfadeleft = SF_COMPRESSOR_DELAYFADE;
+    }
+
+    // push the chunk into the predelay ring and pull the delayed chunk back out. the write goes
+    // first, so a predelay shorter than the chunk reads part of what was just written
+    int stride = delaychannels;
+    for (int ch = 0; ch < numchannels; ch++) {
+        for (int i = 0; i < numsamples; i++) {
+            delayframes[i * stride + ch] = prebuf[ch][i];
+        }
+    }
+    ringwrite(delaybuf, delaymask, stride, delaywritepos, delayframes, numsamples);
+    ringread(delaybuf, delaymask, stride, (delaywritepos - delaysamples) & delaymask, delayframes, numsamples);
+    if (delayfadeleft > 0) {
+        ringread(delaybuf, delaymask, stride, (delaywritepos - fadedelaysamples) & delaymask, fadeframes, numsamples);
+        int fadesamples = numsamples < delayfadeleft ? numsamples : delayfadeleft;
+        Sample fadepos = (Sample)(SF_COMPRESSOR_DELAYFADE - delayfadeleft);
+        for (int i = 0; i < fadesamples; i++) {
+            Sample w = (fadepos + (Sample)(i + 1)) * (1.0f / (Sample)SF_COMPRESSOR_DELAYFADE);
+            for (int ch = 0; ch < numchannels; ch++) {
+                Sample old = fadeframes[i * stride + ch];
+                delayframes[i * stride + ch] = old + (delayframes[i * stride + ch] - old) * w;
+            }
+        }
+        delayfadeleft -= fadesamples;
+    }
+    delaywritepos = (delaywritepos + numsamples) & delaymask;
+
+    // apply the gain of each channel's detector
+    for (int ch = 0; ch < numchannels; ch++) {
+        Sample* outptr = outputs[ch] + samplepos;
+        const Sample* gainptr = gainbuf[channeldetector[ch]];
+        for (int i = 0; i < numsamples; i++) {
+            outptr[i] = delayframes[i * stride + ch] * gainptr[i];
+        }
+    }
+}
+
+// metering only keeps running peaks and sums per chunk, the dB and square root conversions are
+// done once per reading
+template <typename Sample>
+void BasicCompressor<Sample>::meterInput(int numsamples)
+{
+    // the levels of the detectors are not peaks in every link mode, so the peak is taken again here
+    for (int d = 0; d < numdetectors; d++) {
+        for (int i = 0; i < numsamples; i++) {
+            metermingain = gainbuf[d][i] < metermingain ? gainbuf[d][i] : metermingain;
+        }
+    }
+    for (int ch = 0; ch < numchannels; ch++) {
+        for (int i = 0; i < numsamples; i++) {
+            Sample input = absf(prebuf[ch][i]);
+            meterinpeak = input > meterinpeak ? input : meterinpeak;
+            meterinsum += prebuf[ch][i] * prebuf[ch][i];
+        }
+    }
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::meterOutput(Sample* const* outputs, int numsamples)
+{
+    for (int ch = 0; ch < numchannels; ch++) {
+        const Sample* outptr = outputs[ch] + samplepos;
+        for (int i = 0; i < numsamples; i++) {
+            Sample output = absf(outptr[i]);
+            meteroutpeak = output > meteroutpeak ? output : meteroutpeak;
+            meteroutsum += output * output;
+        }
+    }
+
+    metersamples += numsamples;
+    if (metersamples >= SF_COMPRESSOR_METERSAMPLES) {
+        Sample norm = 1.0f / (Sample)(metersamples * numchannels);
+        MeterReading reading;
+        reading.gainreduction = (float)lin2db(metermingain);
+        reading.inputpeak = (float)meterinpeak;
+        reading.inputrms = (float)sqrt(meterinsum * norm);
+        reading.outputpeak = (float)meteroutpeak;
+        reading.outputrms = (float)sqrt(meteroutsum * norm);
+        // a consumer that stopped draining just misses readings, the audio thread never waits
+        meterfifo.push(reading);
+        clearMeter();
+    }
+}
+
+template <typename Sample>
+void BasicCompressor<Sample>::clearMeter()
+{
+    metermingain = 1.0f;
+    meterinpeak = 0.0f;
+    meterinsum = 0.0f;
+    meteroutpeak = 0.0f;
+    meteroutsum = 0.0f;
+    metersamples = 0;
+}
 
-    // apply the gain
-    lptr[samplepos] = delaybufL[delayreadpos] * gain;
-    rptr[samplepos] = delaybufR[delayreadpos] * gain;
-}
\ No newline at end of file
+template class BasicCompressor<float>;
+template class BasicCompressor<double>;
@@ -11,9 +11,22 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
+#include "TripleBuffer.h"
+#include "SpscFifo.h"
+#include "Oversampler.h"
 
-// maximum number of samples in the delay buffer
-#define SF_COMPRESSOR_MAXDELAY   1024
+// longest predelay in seconds the ring is sized for by default, the range of the plugin dial
+#define SF_COMPRESSOR_MAXPREDELAY 0.1f
+
+// longest RMS detector window in seconds, see set_rmswindow
+#define SF_COMPRESSOR_MAXRMSWINDOW 0.5f
+
+// samples over which a predelay change crossfades from the old read tap to the new one
+#define SF_COMPRESSOR_DELAYFADE  256
+
+// maximum number of channels processed by one compressor, and so of detectors, see set_link.
+// covers every JUCE layout up to seventh order ambisonics
+#define SF_COMPRESSOR_MAXCHANNELS 64
 
 // samples per update; the compressor works by dividing the input chunks into even smaller sizes,
 // and performs heavier calculations after each mini-chunk to adjust the final envelope
@@ -22,20 +35,165 @@
 // not sure what this does exactly, but it is part of the release curve
 #define SF_COMPRESSOR_SPACINGDB  5.0f
 
+// fast-math curve table; the table covers SF_COMPRESSOR_CURVEOCTAVES octaves of input level starting
+// at 2^SF_COMPRESSOR_CURVEMINEXP (about -84 dB up to +42 dB), with 2^SF_COMPRESSOR_CURVESTEPBITS
+// points per octave. the index is taken straight from the float exponent/mantissa bits, so a lookup
+// needs no log/pow/exp at all. inputs outside the covered range fall back to the exact curve.
+//
+// worst-case error of the table against the exact compcurve, measured over threshold -60..0 dB,
+// knee 0..60 dB and ratio 2..20 for every level in the table range (see CurveTableTest):
+//   hard knee, or a knee under 1 dB: 0.032 dB, only within one table step of the threshold corner
+//   soft knee of 1 dB and more:      0.017 dB, largest where the knee joins the ratio slope
+#define SF_COMPRESSOR_CURVEMINEXP    -14
+#define SF_COMPRESSOR_CURVEOCTAVES   21
+#define SF_COMPRESSOR_CURVESTEPBITS  6
+#define SF_COMPRESSOR_CURVETABLESIZE ((SF_COMPRESSOR_CURVEOCTAVES << SF_COMPRESSOR_CURVESTEPBITS) + 1)
+
+// metering publishes one reading per SF_COMPRESSOR_METERSAMPLES samples (rounded up to whole chunks),
+// and holds up to SF_COMPRESSOR_METERFIFOSIZE readings the consumer has not drained yet
+#define SF_COMPRESSOR_METERSAMPLES  1024
+#define SF_COMPRESSOR_METERFIFOSIZE 64
+
+// default time a parameter event takes to reach its new value, in seconds
+#define SF_COMPRESSOR_SMOOTHTIME    0.02f
+
+// largest control rate decimation, must divide SF_COMPRESSOR_SPU
+#define SF_COMPRESSOR_MAXDECIMATION 16
+
+// knee solutions remembered per compressor. the cache is keyed by threshold and knee in
+// 1/SF_COMPRESSOR_KNEEDBSTEPS dB steps and ratio in 1/SF_COMPRESSOR_KNEERATIOSTEPS steps, which is
+// the resolution of the plugin dials, so sweeping back and forth over a range only solves each step once
+#define SF_COMPRESSOR_KNEECACHESIZE   64
+#define SF_COMPRESSOR_KNEEDBSTEPS     100
+#define SF_COMPRESSOR_KNEERATIOSTEPS  1000
+
 // already defined in math.h
 // #define M_PI 3.1415926535
 
-class Compressor
+// threading: the set_* functions and setSampleRate belong to the message thread, processBuffer and
+// reset belong to the audio thread. every setting change is published as a complete coefficient
+// snapshot, which processBuffer picks up at the start of the next block without locking.
+//
+// the user parameters can also be changed from the audio thread with timestamped events passed to
+// processBuffer. an event glides to its value with the smoothing picked by set_smoothing, or over the
+// glide it brings along, evaluated at the SF_COMPRESSOR_SPU chunk boundaries. a later set_* of the
+// same parameter overrides it.
+//
+// Sample is the type of the audio, the predelay ring and the detector and envelope state, float or
+// double. the coefficients are derived in float either way, see Compressor and CompressorDouble below
+template <typename Sample>
+class BasicCompressor
 {
 
+	// the bank mirrors the processing below across many instances
+	template <int Lanes> friend class CompressorBank;
+
 public:
 
-    Compressor();
-    ~Compressor();
+	// one metering period, levels are linear and taken across all channels
+	struct MeterReading
+	{
+		float gainreduction; // largest gain reduction in the period, in dB (0 or less)
+		float inputpeak; // after the pregain
+		float inputrms;
+		float outputpeak;
+		float outputrms;
+	};
+
+	// the detector and envelope state carried from one chunk to the next, for each detector in use.
+	// two renders of the same input with equal states at the same chunk boundary, and a predelay ring
+	// filled from the same input, produce the same output from that boundary on. so do the RMS windows,
+	// which are filled from the same input as well, as long as the sums are also equal and the fresh
+	// sums take over at the same sample
+	struct EnvelopeState
+	{
+		struct Detector
+		{
+			Sample detectoravg;
+			Sample compgain;
+			Sample maxcompdiffdb;
+			Sample premixgain;
+			Sample targetgain;
+			Sample rmssum;
+			Sample rmsfresh;
+		};
+		Detector detectors[SF_COMPRESSOR_MAXCHANNELS];
+		int numdetectors;
+		int rmsfill; // squares in the fresh sums, see windowPass
+		// bit for bit, the detectors hold nothing but Samples
+		bool operator==(const EnvelopeState& other) const
+		{
+			if (numdetectors != other.numdetectors || rmsfill != other.rmsfill)
+				return false;
+			return memcmp(detectors, other.detectors, (size_t)numdetectors * sizeof(Detector)) == 0;
+		}
+	};
+
+	// parameters that can be changed by events, values are in the units of the set_* functions
+	// (dB for the gains, threshold and knee, seconds for attack and release, 0..1 for wet) except
+	// that ratioparam takes the ratio rather than the slope
+	enum Parameter { pregainparam, thresholdparam, kneeparam, ratioparam, attackparam, releaseparam,
+		postgainparam, wetparam, numparameters };
+	enum Smoothing { linearsmoothing, exponentialsmoothing };
+	// how the channels of one detector are combined into its level: the peak, the mean of the
+	// magnitudes or the RMS across the channels. independentlink gives every channel a detector of
+	// its own and ignores the link groups
+	enum LinkMode { maxlink, meanlink, rmslink, independentlink };
+	struct ParameterEvent
+	{
+		int sampleoffset; // into the buffer, takes effect at the first chunk boundary at or after it
+		int parameter;
+		float value;
+		int glidesamples = 0; // a linear glide over this many samples, 0 for the one set by set_smoothing
+	};
+
+    BasicCompressor();
+    ~BasicCompressor();
+	// sizes the predelay ring for inputchannels channels and up to maxpredelay seconds at sr_in, and the
+	// RMS windows for as many detectors and SF_COMPRESSOR_MAXRMSWINDOW, then sets the sample rate.
+	// allocates, so it belongs before processing starts (prepareToPlay)
+	void prepare(int sr_in, int inputchannels, float maxpredelay = SF_COMPRESSOR_MAXPREDELAY);
 	void setSampleRate(int sr_in);
-	void processBuffer(juce::AudioBuffer<float>& buffer);
+	// clears the detector, envelope and predelay state, settings are kept
+	void reset();
+	void processBuffer(juce::AudioBuffer<Sample>& buffer);
+	// raw-pointer version for any channel count up to SF_COMPRESSOR_MAXCHANNELS, inputs and outputs
+	// may point to the same buffers for in-place processing
+	void processBuffer(const Sample* const* inputs, Sample* const* outputs, int inputchannels, int numsamples);
+	// the same with parameter events, sorted by sampleoffset. chunk boundaries run on across buffers,
+	// so an event after the last one in a buffer, or past its end, waits for the first one of the next
+	void processBuffer(const Sample* const* inputs, Sample* const* outputs, int inputchannels, int numsamples,
+		const ParameterEvent* events, int numevents);
+	// external sidechain: the detectors listen to the numkeychannels channels of key, after the
+	// pregain, instead of the input. a key with as many channels as the input drives the detector of
+	// each channel from the key channel of the same index, any other key is linked into one level for
+	// every detector. the gain is applied to the input as usual, predelay and metering included
+	void processSidechain(const Sample* const* inputs, Sample* const* outputs, int inputchannels, int numsamples,
+		const Sample* const* key, int numkeychannels, const ParameterEvent* events = nullptr, int numevents = 0);
+	// split processing for one key ducking any number of targets. computeGain runs the detector and
+	// envelope over the key once and writes the gain of every sample to gain, with the pregain, postgain
+	// and wet mix folded in, so applyGain turns a target into what processSidechain would output for it
+	// in zero latency mode, up to the rounding of the pregain. when the link groups leave several
+	// detectors, the lowest gain of them is written. the curve lines up with the key: the predelay ring
+	// is not used, lookahead means delaying the targets. there is no metering. a compressor is used
+	// either this way or with processBuffer
+	void computeGain(const Sample* const* key, int numkeychannels, Sample* gain, int numsamples,
+		const ParameterEvent* events = nullptr, int numevents = 0);
+	// outputs[ch][i] = inputs[ch][i] * gain[i], in place when inputs and outputs are the same
+	static void applyGain(const Sample* gain, const Sample* const* inputs, Sample* const* outputs, int numchannels,
+		int numsamples);
+	// how events of one parameter glide: linear reaches the new value after seconds, exponential
+	// moves with a time constant of seconds. 0 seconds applies events at their chunk boundary right away
+	void set_smoothing(int parameter, Smoothing mode, float seconds);
 	int inline getSampleRate() { return sampleRate; }
-	float inline getKnee() { return knee; }
+	// predelay in samples, as published by set_delaybufsize, plus the delay of the oversampled detector
+	int inline getDelaySamples() { return design.delaysamples; }
+	// zero latency mode skips the predelay ring entirely, the gain is applied to the undelayed input
+	void set_zerolatency(bool enabled);
+	bool inline getZeroLatency() { return design.zerolatency; }
+	// the delay the output has against the input, for host delay compensation
+	int inline getLatencySamples() { return design.zerolatency ? 0 : design.delaysamples; }
+	float inline getKnee() { return design.knee; }
 	void set_slope(float val_in);
 	void set_attack(int sr_in, float attack_in);
 	void set_release(int sr_in, float release_in);
@@ -45,43 +203,179 @@ public:
 	void set_linearthreshold(float val_in);
 	void set_postgain(float val_in) { this->postgain = val_in; calculate_knee(getKnee()); }
 	void calculate_knee(float k_in);
+	void set_fastmath(bool enabled);
+	bool inline getFastMath() { return design.fastmath; }
+	// the static curve of the settings as attenuation (output level over input level) at the linear
+	// level x > 0, from the table when fast math is on. message thread
+	float getCurveAttenuation(float x) const;
+	// switch metering on while a consumer drains the readings. with metering off the chunk kernels
+	// contain no meter code at all
+	void set_metering(bool enabled);
+	bool inline getMetering() { return design.metering; }
+	// consumer side, from any one thread: takes the oldest reading, false when none is waiting
+	bool popMeterReading(MeterReading& reading) { return meterfifo.pop(reading); }
+	// the linear pregain of the last chunk processed, with any glide. audio thread only
+	float inline getLivePregain() const { return cf->linearpregain; }
+	// eco mode: runs the static curve, detector and envelope once per group of 1, 2, 4, 8 or 16
+	// samples on the peak of the group and interpolates the gain over the group after it. 1 is the
+	// exact per-sample processing, other values are rounded down to the nearest power of two. groups
+	// run on across buffers like the chunks, so the output does not depend on the buffer sizes
+	void set_decimation(int factor);
+	int inline getDecimation() { return design.decimation; }
+	// oversampled detector: the detectors take the true peak of every sample period from the input,
+	// or the sidechain, upsampled by 2, 4 or 8, so they catch the inter-sample peaks. only the key path
+	// is oversampled, the envelope and the gain stay at the sample rate; a fully oversampled gain stage
+	// is BasicMultibandCompressor::prepare. the upsampler delays the detector by about
+	// Oversampler::upsampleDelay samples, which is added to the predelay and so to the latency. in zero
+	// latency mode the detector is that much late instead. 1 switches it off
+	void set_detectoroversampling(int factor);
+	int inline getDetectorOversampling() { return design.oversampling; }
+	// RMS detection: the detectors take the root mean square of the linked level over the last
+	// window_in seconds instead of its peak, which follows loudness more closely for speech. the
+	// static curve and the adaptive release work on that level as they do on the peak. the cost per
+	// sample does not depend on the window, up to SF_COMPRESSOR_MAXRMSWINDOW. a window starts from
+	// silence when switched on, a new length takes over the history of the old one. 0 switches back
+	// to the peak detector. computeGain with more unlinked key channels than prepare was given leaves
+	// the detectors past those on the peak
+	void set_rmswindow(int sr_in, float window_in);
+	int inline getRmsWindowSamples() { return design.rmswindow; }
+	// stereo linking generalized to any channel count. the channels are split into link groups, each
+	// group has one detector and envelope, and every channel gets the gain of its group. the default
+	// is a single group with the peak across all channels, the original stereo behaviour. a new
+	// grouping restarts every detector from the state of the one that was reducing the most
+	void set_link(LinkMode mode);
+	LinkMode inline getLink() { return design.linkmode; }
+	// groups[ch] is the group of channel ch, for count channels; the rest keep theirs. group
+	// numbers must be below SF_COMPRESSOR_MAXCHANNELS, e.g. { 0, 0, 1, 2, 2, 2 } for a 5.1 stem
+	// links front left/right, leaves the centre on its own and links LFE and surrounds
+	void set_linkgroups(const int* groups, int count);
+	int inline getLinkGroup(int channel) { return design.linkgroups[channel]; }
+	// audio thread side, only meaningful between two buffers that end on a chunk boundary
+	EnvelopeState getEnvelopeState() const;
+	int inline getChunkPhase() const { return chunkphase; }
+	// audio thread side, right after reset: takes over the chunk phase and the metering period of
+	// leader, so that from here on both change their envelope rates and publish their readings on the
+	// same samples. for compressors that process the same buffers, like the bands of a multiband engine
+	void joinChunkGrid(const BasicCompressor& leader);
 
 private:
 
-	void allocateDelayBuffer();
-	void set_meterrelease(int sr_in);
+	// static curve variants the chunk kernels are specialized on
+	enum CurveKernel { hardkneecurve, softkneecurve, tablecurve };
+	typedef void (BasicCompressor::*ChunkKernel)(const Sample* const* inputs, Sample* const* outputs, int numsamples);
+	// one complete set of coefficients, see below
+	struct Coefficients;
+
+	void allocateDelayBuffer(int frames, int channels);
+	// ring frames needed for maxpredelay seconds at sr_in plus one chunk, rounded up to a power of two
+	static int delayRingFrames(int sr_in, float maxpredelay);
+	void allocateRmsBuffer(int frames, int rows);
+	// ring frames for SF_COMPRESSOR_MAXRMSWINDOW at sr_in, rounded up to a power of two
+	static int rmsRingFrames(int sr_in);
 	void calculate_releasecurve();
-	void perSampleProcessing(juce::AudioBuffer<float>& buffer, float* lptr, float* rptr);
+	static void releasecurve(float releasesamples, float zone1, float zone2, float zone3, float zone4,
+		float& a, float& b, float& c, float& d);
+	void calculate_curvetable();
+	// knee shape for threshold, knee and slope, from the cache when the tuple was solved before
+	struct KneeSolution;
+	struct KneeCache;
+	static const KneeSolution& kneesolution(KneeCache& cache, float threshold, float knee, float slope);
+	static void solveknee(float threshold, float knee, float slope, KneeSolution& solution);
+
+	// audio thread side of the parameter events
+	void startSmoothing(const ParameterEvent& event);
+	// the chunk loop behind all processing entry points, with the sidechain and gaincurve members set
+	void processChunks(const Sample* const* inputs, Sample* const* outputs, int numsamples,
+		const ParameterEvent* events, int numevents);
+	void advanceSmoothing(int numsamples);
+	// starts the held and the due events at a chunk boundary
+	void applyEvents(const ParameterEvent* events, int numevents, int& nextevent);
+	// recomputes the live coefficients from the smoothed parameters
+	void updateLive();
+	// looks up the knee for the targets of a threshold, knee or ratio glide, the live curve is the start
+	void startKneeGlide();
+	// maps the channels of the current buffer to detectors, after a new snapshot or channel count
+	void linkChannels();
+	// audio thread side of set_rmswindow, sums the history for a new window length
+	void resizeWindow();
+	void calculateEnvelopeRate();
+	template <int Curve, bool UnityPregain, bool FullWet, bool Metering>
+	void processChunk(const Sample* const* inputs, Sample* const* outputs, int numsamples);
+	template <int Curve, bool UnityPregain, bool FullWet, bool Metering>
+	void processDecimatedChunk(const Sample* const* inputs, Sample* const* outputs, int numsamples);
+	template <int Curve, bool UnityPregain>
+	void detectorPass(const Sample* const* inputs, int numsamples);
+	template <bool UnityPregain>
+	void inputPass(const Sample* const* inputs, int numsamples);
+	// one channel as the detectors see it, the true peaks of the oversampled channel when set
+	const Sample* detectorInput(int channel, const Sample* input, int numsamples);
+	// adds one channel to the level of a detector, Scaled multiplies it by gain on the way
+	template <bool Scaled>
+	static void accumulateLevel(Sample* level, const Sample* channel, Sample gain, LinkMode linkmode, int numsamples);
+	static void finishLevel(Sample* level, Sample scale, LinkMode linkmode, int numsamples);
+	void windowPass(int numsamples);
+	template <int Curve>
+	Sample curveAttenuation(Sample inputmax);
+	void envelopePass(int numsamples);
+	template <int Curve>
+	void decimatedEnvelopePass(int numsamples);
+	void gainLawPass(int numsamples);
+	template <bool FullWet, bool Metering>
+	void gainPass(Sample* const* outputs, int numsamples);
+	void outputPass(Sample* const* outputs, int numsamples);
+	void curvePass(int numsamples);
+	void meterInput(int numsamples);
+	void meterOutput(Sample* const* outputs, int numsamples);
+	void clearMeter();
+
+	// hands the current design over to the audio thread, called at the end of every set_*
+	void publish();
+	// audio thread side of publish, switches cf to the newest design if there is one
+	void acquire();
+	// picks the chunk kernel for the current configuration
+	void select_kernel();
+	// kernel for a set of coefficients, usetable only when their curve table is up to date
+	ChunkKernel chooseKernel(const Coefficients& c, bool usetable);
+	template <int Curve, bool UnityPregain, bool FullWet>
+	ChunkKernel kernelFor(bool metering, bool decimated);
+	template <int Curve, bool UnityPregain>
+	ChunkKernel kernelFor(bool fullwet, bool metering, bool decimated);
+	template <int Curve>
+	ChunkKernel kernelFor(bool unitypregain, bool fullwet, bool metering, bool decimated);
 
 	// only compressor setup since this will only once be called in the constructor
 	void sf_advancecomp(float pregain, float threshold,
 		float knee, float ratio, float attack, float release, float predelay, float releasezone1,
 		float releasezone2, float releasezone3, float releasezone4, float postgain, float wet);
 
-	// inline functions from the original compressor implementation
-	static inline float db2lin(float db) { // dB to linear
-		return pow(10.0f, 0.05f * db);
+	// inline functions from the original compressor implementation. the ones the audio path calls
+	// take the level in T, which is float for the coefficients and Sample for the audio
+	template <typename T>
+	static inline T db2lin(T db) { // dB to linear
+		return pow((T)10.0f, (T)0.05f * db);
 	}
-	static inline float lin2db(float lin) { // linear to dB
+	template <typename T>
+	static inline T lin2db(T lin) { // linear to dB
 		if (lin <= 0)
 		{
 			return -100;
 		}
 		else
 		{
-			return 20.0f * log10(lin);
+			return (T)20.0f * log10(lin);
 		}
 	}
-	static inline float kneecurve(float x, float k, float linearthreshold) {
+	template <typename T>
+	static inline T kneecurve(T x, float k, float linearthreshold) {
 		// remove once bug is solved
 		//DBG("x: " << x << ", k: " << k << ", linthresh: " << linearthreshold);
-		float val = linearthreshold + (1.0f - exp(-k * (x - linearthreshold))) / k; DBG("val: " << val);
-		return val;
+		return linearthreshold + ((T)1.0f - exp(-k * (x - linearthreshold))) / k;
 	}
 	static inline float kneeslope(float x, float k, float linearthreshold) {
 		return k * x / ((k * linearthreshold + 1.0f) * exp(k * (x - linearthreshold)) - 1);
 	}
-	static inline float compcurve(float x, float k, float slope, float linearthreshold,
+	template <typename T>
+	static inline T compcurve(T x, float k, float slope, float linearthreshold,
 		float linearthresholdknee, float threshold, float knee, float kneedboffset) {
 		if (x < linearthreshold)
 			return x; //DBG("x < linthresh");
@@ -93,25 +387,79 @@ private:
 	}
 	// for more information on the adaptive release curve, check out adaptive-release-curve.html demo +
 	// source code included in this repo
-	static inline float adaptivereleasecurve(float x, float a, float b, float c, float d) {
+	template <typename T>
+	static inline T adaptivereleasecurve(T x, float a, float b, float c, float d) {
 		// a*x^3 + b*x^2 + c*x + d
-		float x2 = x * x;
+		T x2 = x * x;
 		return a * x2 * x + b * x2 + c * x + d;
 	}
-	static inline float clampf(float v, float min, float max) {
-		return v < min ? min : (v > max ? max : v);
+	// static curve as attenuation (compcurve(x) / x), read from a table built by calculate_curvetable
+	static inline float curveattenuation(const float* table, float x, float k, float slope, float linearthreshold,
+		float linearthresholdknee, float threshold, float knee, float kneedboffset) {
+		uint32_t bits;
+		memcpy(&bits, &x, sizeof(bits));
+		// unsigned wrap-around puts levels below the table start out of range as well
+		uint32_t rel = bits - ((uint32_t)(127 + SF_COMPRESSOR_CURVEMINEXP) << 23);
+		if (rel >= ((uint32_t)SF_COMPRESSOR_CURVEOCTAVES << 23))
+			return compcurve(x, k, slope, linearthreshold, linearthresholdknee, threshold, knee, kneedboffset) / x;
+		uint32_t idx = rel >> (23 - SF_COMPRESSOR_CURVESTEPBITS);
+		float frac = (float)(rel & ((1u << (23 - SF_COMPRESSOR_CURVESTEPBITS)) - 1u))
+			* (1.0f / (float)(1u << (23 - SF_COMPRESSOR_CURVESTEPBITS)));
+		return table[idx] + (table[idx + 1] - table[idx]) * frac;
+	}
+	// the predelay ring holds interleaved frames of stride samples and is mask + 1 frames long. a chunk
+	// never wraps more than once, so every transfer is at most two block copies
+	template <typename T>
+	static inline void ringwrite(T* ring, int mask, int stride, int pos, const T* frames, int numframes) {
+		int first = mask + 1 - pos;
+		if (first > numframes)
+			first = numframes;
+		memcpy(ring + (size_t)pos * (size_t)stride, frames, (size_t)first * (size_t)stride * sizeof(T));
+		memcpy(ring, frames + (size_t)first * (size_t)stride, (size_t)(numframes - first) * (size_t)stride * sizeof(T));
 	}
-	static inline float absf(float v) {
-		return v < 0.0f ? -v : v;
+	template <typename T>
+	static inline void ringread(const T* ring, int mask, int stride, int pos, T* frames, int numframes) {
+		int first = mask + 1 - pos;
+		if (first > numframes)
+			first = numframes;
+		memcpy(frames, ring + (size_t)pos * (size_t)stride, (size_t)first * (size_t)stride * sizeof(T));
+		memcpy(frames + (size_t)first * (size_t)stride, ring, (size_t)(numframes - first) * (size_t)stride * sizeof(T));
 	}
-	inline float fixf(float v, float def) {
+	// malloc with the result rounded up to a cache line, mem receives the pointer to free
+	template <typename T = float>
+	static inline T* alignedalloc(size_t bytes, void*& mem) {
+		mem = malloc(bytes + 63);
+		return (T*)(((uintptr_t)mem + 63) & ~(uintptr_t)63);
+	}
+	// x^n for small positive n, by squaring
+	template <typename T>
+	static inline T powi(T x, int n) {
+		T result = 1.0f;
+		while (n > 0) {
+			if (n & 1)
+				result *= x;
+			x *= x;
+			n >>= 1;
+		}
+		return result;
+	}
+	template <typename T>
+	static inline T clampf(T v, float min, float max) {
+		return v < min ? (T)min : (v > max ? (T)max : v);
+	}
+	template <typename T>
+	static inline T absf(T v) {
+		return v < (T)0.0f ? -v : v;
+	}
+	template <typename T>
+	inline T fixf(T v, float def) {
 		// fix NaN and infinity values that sneak in... not sure why this is needed, but it is
 		if (std::isnan(v) || std::isinf(v))
 		{
 			DBG("fixf check out of bounds, v set to def at value: " << def);
 			DBG("v was value: " << v);
 			DBG("linenr: " << getlinenr());
-			return def;
+			return (T)def;
 		}
 		return v;
 	}
@@ -123,46 +471,186 @@ private:
 
     int sampleRate = 48000;
 
-	// all struct parameters from the original code
-	float metergain = 1.0;
-	float meterrelease;
-	float threshold;
-	float knee;
-	float linearpregain;
-	float linearthreshold;
-	float slope;
-	float attacksamplesinv;
-	float satreleasesamplesinv;
-	float wet;
-	float dry;
-	float k = 5.0f;
-	float kneedboffset = 0.0f;
-	float linearthresholdknee = 0.0f;
-	float mastergain;
-	float a; // adaptive release polynomial coefficients
-	float b;
-	float c;
-	float d;
-	float detectoravg = 0.0001f;
-	float compgain = 1.0f;
-	float maxcompdiffdb = -1.0f;
-	int delaybufsize = SF_COMPRESSOR_MAXDELAY;
+	// everything the processing reads but never writes, from the struct parameters of the original code
+	struct Coefficients
+	{
+		float threshold;
+		float knee = 0.0f;
+		float linearpregain = 1.0f;
+		float linearthreshold;
+		float slope;
+		float attacksamplesinv;
+		float satreleasesamplesinv;
+		float wet = 1.0f;
+		float dry = 0.0f;
+		float k = 5.0f;
+		float kneedboffset = 0.0f;
+		float linearthresholdknee = 0.0f;
+		float mastergain;
+		float a; // adaptive release polynomial coefficients
+		float b;
+		float c;
+		float d;
+		int delaysamples = 0; // predelay, at most delaymask + 1 - SF_COMPRESSOR_SPU
+		bool zerolatency = false;
+		bool fastmath = false;
+		bool metering = false;
+		int decimation = 1;
+		int oversampling = 1; // detector oversampling factor
+		int rmswindow = 0; // RMS detector window in samples, 0 for the peak detector
+		int samplerate = 48000;
+		float curvegain = 1.0f; // part of mastergain that comes from the curve, without the postgain
+		float releasezones[4];
+		float params[numparameters]; // the user values the coefficients above were derived from
+		Smoothing smoothingmode[numparameters];
+		float smoothingtime[numparameters];
+		ChunkKernel chunkkernel = nullptr;
+		LinkMode linkmode = maxlink;
+		int linkgroups[SF_COMPRESSOR_MAXCHANNELS] = {}; // link group of each channel
+		float curvetable[SF_COMPRESSOR_CURVETABLESIZE]; // fast-math static curve
+	};
+
+	Coefficients design; // message thread copy, edited by the set_* functions
+	TripleBuffer<Coefficients> exchange;
+	// audio thread copy of the latest snapshot, adjusted at chunk boundaries while events glide
+	Coefficients live;
+	const Coefficients* cf = &live;
+
+	// one smoothed parameter on the audio thread
+	struct Smoother
+	{
+		float current;
+		float target;
+		float step; // linear: change per sample
+		float coefficient; // exponential: part of the distance kept per sample
+		int samplesleft; // linear: samples until the target is reached
+		Smoothing mode;
+	};
+	Smoother smoothers[numparameters];
+	float snapshotparams[numparameters]; // params of the last snapshot, a change there overrides the events
+	bool smoothing = false; // some smoother has not reached its target
+	bool liveisdesign = true; // live equals the snapshot, so the snapshot's kernel and curve table hold
+	ParameterEvent pendingevents[numparameters]; // events that arrived after the last chunk boundary of a buffer
+	// the knee solution at both ends of the current threshold, knee or ratio glide, see updateLive
+	struct KneeEnd
+	{
+		float threshold;
+		float knee;
+		float slope;
+		float k;
+		float curvegain;
+	};
+	KneeEnd kneefrom = {};
+	KneeEnd kneeto = {};
+	bool pending[numparameters] = {};
+
+	// derived knee coefficients for one quantized threshold/knee/ratio tuple
+	struct KneeSolution
+	{
+		int thresholdkey;
+		int kneekey;
+		int ratiokey;
+		float k;
+		float kneedboffset;
+		float linearthresholdknee;
+		float fulllevel; // curve output at 0 dBFS, the base of the master gain
+		float curvegain; // the makeup gain that goes with it
+	};
+	struct KneeCache
+	{
+		KneeSolution entries[SF_COMPRESSOR_KNEECACHESIZE];
+		int size = 0;
+		int next = 0; // oldest entry, replaced first once the cache is full
+		KneeSolution uncached; // for slopes too flat to key by ratio
+	};
+	KneeCache kneecache; // message thread, for calculate_knee
+	KneeCache glidecache; // audio thread, for the targets of the knee glides
+
+	// processing state, only touched by the audio thread
+	// one detector and envelope per link group
+	struct Detector
+	{
+		Sample detectoravg = (Sample)0.0001f;
+		Sample compgain = 1.0f;
+		Sample maxcompdiffdb = -1.0f;
+		Sample enveloperate;
+		Sample scaleddesiredgain;
+		Sample premixgain = 1.0f; // last gain after the gain law, where the decimated interpolation starts
+		Sample targetgain = 1.0f; // where it ends, the gain after the last complete decimation group
+		Sample groupmax = 0.0f; // peak of the decimation group so far, carried across buffers
+		Sample rmssum = 0.0f; // squares in the RMS window
+		Sample rmsfresh = 0.0f; // squares since the last swap, see windowPass
+	};
+	Detector detectors[SF_COMPRESSOR_MAXCHANNELS];
+	int numdetectors = 1;
+	int channeldetector[SF_COMPRESSOR_MAXCHANNELS] = {}; // detector of each channel
+	Sample detectorscale[SF_COMPRESSOR_MAXCHANNELS]; // 1 / channels of the detector, for mean and RMS
+	int linkedchannels = 0; // channel count linkChannels last ran for, 0 after a new snapshot
+	int delaysamples = 0; // read tap, trails cf->delaysamples while a crossfade is running
 	int delaywritepos = 0;
-	int delayreadpos = delaybufsize > 1 ? 1 : 0;
-	float* delaybufL; float* delaybufR; // predelay buffer
+	int fadedelaysamples = 0; // read tap being faded out
+	int delayfadeleft = 0; // samples left in the crossfade, 0 when not fading
+	bool zerolatency = false; // the ring holds no valid history while this is set
+
+	// predelay ring, sized by prepare. frames are interleaved across delaychannels channels
+	void* delaymem = nullptr;
+	Sample* delaybuf = nullptr; // delaymem rounded up to a cache line
+	int delaymask = 0; // ring length in frames minus one
+	int delaychannels = 0;
+
+	// RMS windows, sized by prepare. one row of squared levels per detector, written in lockstep
+	void* rmsmem = nullptr;
+	Sample* rmsbuf = nullptr;
+	int rmsmask = 0; // row length minus one
+	int rmsrows = 0;
+	int rmswritepos = 0;
+	int rmsfill = 0; // squares in the fresh sums
+	int rmswindow = 0; // window the rows are summed over, trails cf->rmswindow
 
 	// additional parameters due to changeable samplerate
 	float predelay;
+	float rmswindowtime = 0.0f;
 	float attack;
 	float release;
 	float releasesamples;
 	float postgain;
 	float releasezone1, releasezone2, releasezone3, releasezone4;
 	int size;
-	float ang90 = (float)M_PI * 0.5f;
-	float ang90inv = 2.0f / (float)M_PI;
-	float enveloperate;
+	Sample ang90 = (Sample)M_PI * (Sample)0.5f;
+	Sample ang90inv = (Sample)2.0f / (Sample)M_PI;
 	int samplepos;
-	float scaleddesiredgain;
+	int chunkphase = 0; // samples of the current SF_COMPRESSOR_SPU chunk already processed, carried across buffers
 	int debuglinenr;
+
+	// the key of processSidechain and computeGain, nullptr when the detectors listen to the input
+	const Sample* const* sidechain = nullptr;
+	int numsidechain = 0;
+	Sample* gaincurve = nullptr; // where computeGain wants the curve, nullptr for the normal output
+
+	// per-chunk scratch shared by the three processing passes
+	int numchannels = 2;
+	Sample prebuf[SF_COMPRESSOR_MAXCHANNELS][SF_COMPRESSOR_SPU]; // input after pregain
+	Sample levelbuf[SF_COMPRESSOR_MAXCHANNELS][SF_COMPRESSOR_SPU]; // linked level per detector
+	Sample attenuationbuf[SF_COMPRESSOR_MAXCHANNELS][SF_COMPRESSOR_SPU]; // static curve attenuation per sample
+	Sample gainbuf[SF_COMPRESSOR_MAXCHANNELS][SF_COMPRESSOR_SPU]; // envelope gain, then the final output gain
+	Sample delayframes[SF_COMPRESSOR_SPU * SF_COMPRESSOR_MAXCHANNELS]; // chunk to and from the ring, interleaved
+	Sample fadeframes[SF_COMPRESSOR_SPU * SF_COMPRESSOR_MAXCHANNELS]; // the same chunk from the old tap
+
+	// oversampled detector, upsampling only, for every channel a key may have
+	BasicOversampler<Sample> keyoversampler;
+	Sample upbuf[SF_COMPRESSOR_SPU * SF_OVERSAMPLER_MAXFACTOR]; // one channel of the chunk, upsampled
+	Sample peakbuf[SF_COMPRESSOR_SPU]; // its true peak per sample period
+
+	// metering accumulators for the current period, audio thread only
+	Sample metermingain = 1.0f;
+	Sample meterinpeak = 0.0f;
+	Sample meterinsum = 0.0f;
+	Sample meteroutpeak = 0.0f;
+	Sample meteroutsum = 0.0f;
+	int metersamples = 0;
+	SpscFifo<MeterReading, SF_COMPRESSOR_METERFIFOSIZE> meterfifo;
 };
+
+// the single precision compressor everything but the double precision host path uses
+typedef BasicCompressor<float> Compressor;
+typedef BasicCompressor<double> CompressorDouble;
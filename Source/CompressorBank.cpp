@@ -0,0 +1,343 @@
+/*
+  ==============================================================================
+
+    CompressorBank.cpp
+    Created: 17 Oct 2026 4:20:11pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#include "CompressorBank.h"
+#include <math.h>
+
+// the gain law angles, as Compressor::ang90 and Compressor::ang90inv
+static const float ang90 = (float)M_PI * 0.5f;
+static const float ang90inv = 2.0f / (float)M_PI;
+
+template <int Lanes>
+CompressorBank<Lanes>::CompressorBank(int instances, int samplerate)
+{
+    numinstances = instances;
+    numlanes = ((numinstances + Lanes - 1) / Lanes) * Lanes;
+    groups.resize((size_t)(numlanes / Lanes));
+    curvetables.resize((size_t)numlanes * SF_COMPRESSOR_CURVETABLESIZE);
+    int ringframes = Compressor::delayRingFrames(samplerate, SF_COMPRESSOR_MAXPREDELAY);
+    delaymask = ringframes - 1;
+    delaybuf = Compressor::alignedalloc((size_t)numlanes * (size_t)ringframes * 2 * sizeof(float), delaymem);
+
+    // every lane, including the padding of the last group, starts out as a default compressor
+    Compressor defaults;
+    for (int i = 0; i < numlanes; i++)
+    {
+        setLane(i, defaults);
+    }
+}
+
+template <int Lanes>
+CompressorBank<Lanes>::~CompressorBank()
+{
+    free(delaymem);
+}
+
+template <int Lanes>
+void CompressorBank<Lanes>::setInstance(int index, const Compressor& comp)
+{
+    jassert(index >= 0 && index < numinstances);
+    setLane(index, comp);
+}
+
+template <int Lanes>
+void CompressorBank<Lanes>::setLane(int index, const Compressor& comp)
+{
+    LaneGroup& g = groups[(size_t)(index / Lanes)];
+    int l = index % Lanes;
+    // the bank is set up from the message thread, so it takes the latest settings rather than the
+    // snapshot the audio thread is using
+    const Compressor::Coefficients& design = comp.design;
+    // the bank only mirrors the per-sample processing, eco mode, the oversampled detector and the RMS
+    // window are not supported here
+    jassert(design.decimation == 1 && design.oversampling == 1 && design.rmswindow == 0);
+
+    // the curve kernel Compressor::chooseKernel picks for the settings
+    if (design.fastmath)
+    {
+        g.curve[l] = Compressor::tablecurve;
+        memcpy(curvetables.data() + (size_t)index * SF_COMPRESSOR_CURVETABLESIZE, design.curvetable,
+            sizeof(design.curvetable));
+    }
+    else
+    {
+        g.curve[l] = design.knee > 0.0f ? Compressor::softkneecurve : Compressor::hardkneecurve;
+    }
+    g.linearpregain[l] = design.linearpregain;
+    g.threshold[l] = design.threshold;
+    g.knee[l] = design.knee;
+    g.slope[l] = design.slope;
+    g.k[l] = design.k;
+    g.kneedboffset[l] = design.kneedboffset;
+    g.linearthreshold[l] = design.linearthreshold;
+    g.linearthresholdknee[l] = design.linearthresholdknee;
+    g.a[l] = design.a;
+    g.b[l] = design.b;
+    g.c[l] = design.c;
+    g.d[l] = design.d;
+    g.attacksamplesinv[l] = design.attacksamplesinv;
+    g.satreleasesamplesinv[l] = design.satreleasesamplesinv;
+    g.fullwet[l] = design.wet == 1.0f && design.dry == 0.0f;
+    g.mastergain[l] = design.mastergain;
+    g.wetgain[l] = design.wet * design.mastergain;
+    g.dry[l] = design.dry;
+
+    // lanes are stereo linked on the peak, the compressor's default
+    jassert(design.linkmode == Compressor::maxlink && comp.numdetectors == 1);
+    const Compressor::Detector& det = comp.detectors[0];
+    g.detectoravg[l] = det.detectoravg;
+    g.compgain[l] = det.compgain;
+    g.maxcompdiffdb[l] = det.maxcompdiffdb;
+    g.enveloperate[l] = det.enveloperate;
+    g.scaleddesiredgain[l] = det.scaleddesiredgain;
+    // a compressor prepared for a longer predelay than the bank rings hold gets clamped. zero latency
+    // mode reads back the chunk that was just written, which gives the same output as the bypass.
+    // the lane starts at the published predelay, a crossfade the compressor has still to run is skipped
+    jassert(design.delaysamples <= delaymask + 1 - SF_COMPRESSOR_SPU);
+    g.delaysamples[l] = design.zerolatency ? 0 : juce::jmin(design.delaysamples, delaymask + 1 - SF_COMPRESSOR_SPU);
+
+    // copy the newest frames of the compressor ring so that they end just before the lane's write position.
+    // a mono compressor feeds both sides
+    float* ring = delaybuf + (size_t)index * (size_t)(delaymask + 1) * 2;
+    memset(ring, 0, (size_t)(delaymask + 1) * 2 * sizeof(float));
+    int frames = juce::jmin(delaymask, comp.delaymask) + 1;
+    int right = comp.delaychannels > 1 ? 1 : 0;
+    for (int i = 0; i < frames; i++)
+    {
+        const float* frame = comp.delaybuf + (size_t)((comp.delaywritepos - frames + i) & comp.delaymask) * (size_t)comp.delaychannels;
+        int pos = delaymask + 1 - frames + i;
+        ring[pos * 2] = frame[0];
+        ring[pos * 2 + 1] = frame[right];
+    }
+    g.delaywritepos[l] = 0;
+    // all lanes share one chunk grid, which continues the one of the compressor copied last
+    chunkphase = comp.chunkphase;
+}
+
+template <int Lanes>
+void CompressorBank<Lanes>::processBuffers(float* const* lptrs, float* const* rptrs, int numsamples)
+{
+    if (numsamples <= 0)
+    {
+        return;
+    }
+    // same chunk grid as Compressor::processBuffer, carried across calls and shared by every lane
+    int startphase = chunkphase;
+    for (size_t gi = 0; gi < groups.size(); gi++)
+    {
+        LaneGroup& g = groups[gi];
+        int firstlane = (int)gi * Lanes;
+        samplepos = 0;
+        chunkphase = startphase;
+
+        while (samplepos < numsamples) {
+            if (chunkphase == 0) {
+                calculateEnvelopeRate(g);
+            }
+            int numchunk = SF_COMPRESSOR_SPU - chunkphase;
+            if (numchunk > numsamples - samplepos) {
+                numchunk = numsamples - samplepos;
+            }
+            detectorPass(g, lptrs, rptrs, firstlane, numchunk);
+            envelopePass(g, numchunk);
+            gainPass(g, lptrs, rptrs, firstlane, numchunk);
+            samplepos += numchunk;
+            chunkphase = (chunkphase + numchunk) & (SF_COMPRESSOR_SPU - 1);
+        }
+    }
+}
+
+// Compressor::calculateEnvelopeRate for every lane
+template <int Lanes>
+void CompressorBank<Lanes>::calculateEnvelopeRate(LaneGroup& g)
+{
+    for (int l = 0; l < Lanes; l++) {
+        g.detectoravg[l] = fixf(g.detectoravg[l], 1.0f);
+        float desiredgain = g.detectoravg[l];
+        g.scaleddesiredgain[l] = asin(desiredgain) * ang90inv;
+        float compdiffdb = Compressor::lin2db(g.compgain[l] / g.scaleddesiredgain[l]);
+
+        if (compdiffdb < 0.0f) { // releasing
+            compdiffdb = fixf(compdiffdb, -1.0f);
+            g.maxcompdiffdb[l] = -1.0f;
+            float x = (Compressor::clampf(compdiffdb, -12.0f, 0.0f) + 12.0f) * 0.25f;
+            float releasesamples = Compressor::adaptivereleasecurve(x, g.a[l], g.b[l], g.c[l], g.d[l]);
+            g.enveloperate[l] = Compressor::db2lin(SF_COMPRESSOR_SPACINGDB / releasesamples);
+        }
+        else { // attacking
+            compdiffdb = fixf(compdiffdb, 1.0f);
+            // the reset value -1 is below any difference that is attacking, so it needs no test of its own
+            if (g.maxcompdiffdb[l] < compdiffdb) {
+                g.maxcompdiffdb[l] = compdiffdb;
+            }
+            float attenuate = g.maxcompdiffdb[l];
+            if (attenuate < 0.5f) {
+                attenuate = 0.5f;
+            }
+            g.enveloperate[l] = 1.0f - pow(0.25f / attenuate, g.attacksamplesinv[l]);
+        }
+    }
+}
+
+// Compressor::curveAttenuation, with the kernel of the lane picked at run time
+template <int Lanes>
+inline float CompressorBank<Lanes>::curveAttenuation(const LaneGroup& g, int lane, float inputmax)
+{
+    int l = lane % Lanes;
+    if (inputmax < 0.0001f) {
+        return 1.0f;
+    }
+    else if (g.curve[l] == Compressor::tablecurve) {
+        return Compressor::curveattenuation(curvetables.data() + (size_t)lane * SF_COMPRESSOR_CURVETABLESIZE,
+            inputmax, g.k[l], g.slope[l], g.linearthreshold[l], g.linearthresholdknee[l], g.threshold[l],
+            g.knee[l], g.kneedboffset[l]);
+    }
+    else if (inputmax < g.linearthreshold[l]) {
+        return 1.0f;
+    }
+    else if (g.curve[l] == Compressor::hardkneecurve) {
+        return Compressor::db2lin(g.threshold[l] + g.slope[l] * (Compressor::lin2db(inputmax) - g.threshold[l])) / inputmax;
+    }
+    else if (inputmax < g.linearthresholdknee[l]) {
+        return Compressor::kneecurve(inputmax, g.k[l], g.linearthreshold[l]) / inputmax;
+    }
+    return Compressor::db2lin(g.kneedboffset[l] + g.slope[l] * (Compressor::lin2db(inputmax) - g.threshold[l] - g.knee[l]))
+        / inputmax;
+}
+
+template <int Lanes>
+void CompressorBank<Lanes>::detectorPass(LaneGroup& g, float* const* lptrs, float* const* rptrs,
+    int firstlane, int numsamples)
+{
+    // gather the inputs, padding lanes see silence
+    for (int l = 0; l < Lanes; l++) {
+        if (firstlane + l < numinstances) {
+            const float* lptr = lptrs[firstlane + l] + samplepos;
+            const float* rptr = rptrs[firstlane + l] + samplepos;
+            for (int i = 0; i < numsamples; i++) {
+                prebufL[i][l] = lptr[i] * g.linearpregain[l];
+                prebufR[i][l] = rptr[i] * g.linearpregain[l];
+            }
+        }
+        else {
+            for (int i = 0; i < numsamples; i++) {
+                prebufL[i][l] = 0.0f;
+                prebufR[i][l] = 0.0f;
+            }
+        }
+    }
+
+    // the peak of both sides in the order Compressor::accumulateLevel takes it, then the static curve
+    for (int i = 0; i < numsamples; i++) {
+        for (int l = 0; l < Lanes; l++) {
+            float inputL = Compressor::absf(prebufL[i][l]);
+            float inputR = Compressor::absf(prebufR[i][l]);
+            float level = 0.0f;
+            level = inputL > level ? inputL : level;
+            level = inputR > level ? inputR : level;
+            attenuationbuf[i][l] = curveAttenuation(g, firstlane + l, level);
+        }
+    }
+}
+
+template <int Lanes>
+void CompressorBank<Lanes>::envelopePass(LaneGroup& g, int numsamples)
+{
+    // the detector releases through db2lin, so it runs lane by lane
+    for (int l = 0; l < Lanes; l++) {
+        float detectoravg = g.detectoravg[l];
+        for (int i = 0; i < numsamples; i++) {
+            float attenuation = attenuationbuf[i][l];
+            float rate;
+            if (attenuation > detectoravg) { // if releasing
+                float attenuationdb = -Compressor::lin2db(attenuation);
+                if (attenuationdb < 2.0f) {
+                    attenuationdb = 2.0f;
+                }
+                float dbpersample = attenuationdb * g.satreleasesamplesinv[l];
+                rate = Compressor::db2lin(dbpersample) - 1.0f;
+            }
+            else {
+                rate = 1.0f;
+            }
+
+            detectoravg += (attenuation - detectoravg) * rate;
+            if (detectoravg > 1.0f) {
+                detectoravg = 1.0f;
+            }
+            detectoravg = fixf(detectoravg, 1.0f);
+        }
+        g.detectoravg[l] = detectoravg;
+    }
+
+    // attack reduces the gain towards the desired one, release raises it up to 1. both are worked out
+    // and the lane picks its direction, the state is kept in locals for the length of the chunk
+    float compgains[lanewidth];
+    memcpy(compgains, g.compgain, sizeof(compgains));
+    for (int i = 0; i < numsamples; i++) {
+        for (int l = 0; l < Lanes; l++) {
+            float compgain = compgains[l];
+            float enveloperate = g.enveloperate[l];
+            float attack = compgain + (g.scaleddesiredgain[l] - compgain) * enveloperate;
+            float release = compgain * enveloperate;
+            release = release > 1.0f ? 1.0f : release;
+            compgain = enveloperate < 1.0f ? attack : release;
+            compgains[l] = compgain;
+            gainbuf[i][l] = compgain;
+        }
+    }
+    memcpy(g.compgain, compgains, sizeof(compgains));
+}
+
+template <int Lanes>
+void CompressorBank<Lanes>::gainPass(LaneGroup& g, float* const* lptrs, float* const* rptrs,
+    int firstlane, int numsamples)
+{
+    // the gain law, then the mix
+    for (int i = 0; i < numsamples; i++) {
+        for (int l = 0; l < Lanes; l++) {
+            gainbuf[i][l] = sin(ang90 * gainbuf[i][l]);
+        }
+    }
+    for (int i = 0; i < numsamples; i++) {
+        for (int l = 0; l < Lanes; l++) {
+            float fullwet = g.mastergain[l] * gainbuf[i][l];
+            float mixed = g.dry[l] + g.wetgain[l] * gainbuf[i][l];
+            gainbuf[i][l] = g.fullwet[l] ? fullwet : mixed;
+        }
+    }
+
+    // the predelay rings are separate per lane, so the output is written lane by lane
+    for (int l = 0; l < Lanes; l++) {
+        int lane = firstlane + l;
+        float* ring = delaybuf + (size_t)lane * (size_t)(delaymask + 1) * 2;
+        int delaywritepos = g.delaywritepos[l];
+        for (int i = 0; i < numsamples; i++) {
+            delayframes[i * 2] = prebufL[i][l];
+            delayframes[i * 2 + 1] = prebufR[i][l];
+        }
+        Compressor::ringwrite(ring, delaymask, 2, delaywritepos, delayframes, numsamples);
+        Compressor::ringread(ring, delaymask, 2, (delaywritepos - g.delaysamples[l]) & delaymask, delayframes, numsamples);
+        g.delaywritepos[l] = (delaywritepos + numsamples) & delaymask;
+
+        if (lane < numinstances) {
+            float* lptr = lptrs[lane] + samplepos;
+            float* rptr = rptrs[lane] + samplepos;
+            for (int i = 0; i < numsamples; i++) {
+                lptr[i] = delayframes[i * 2] * gainbuf[i][l];
+                rptr[i] = delayframes[i * 2 + 1] * gainbuf[i][l];
+            }
+        }
+    }
+}
+
+template class CompressorBank<4>;
+template class CompressorBank<8>;
+template class CompressorBank<16>;
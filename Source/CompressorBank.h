@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    CompressorBank.h
+    Created: 17 Oct 2026 4:20:11pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+#include "Compressor.h"
+
+// runs many independent stereo compressors side by side. instances are packed in groups of Lanes
+// (4, 8 or 16) with every field stored as a structure of arrays, and each step of the Compressor
+// passes is done for the whole group at once. because the lanes are separate instances, the
+// detector/envelope recurrence runs across lanes instead of across samples.
+//
+// a lane gives exactly the output of Compressor::processBuffer with the same settings and state. it
+// calls the same dB, curve and release functions of Compressor and the same library sin, asin and pow
+// in the same order, and takes the same branches, the static curve kernel and the curve table of
+// set_fastmath included. where both sides of a branch are plain arithmetic, in the envelope gain and
+// the mix, both are worked out for the whole group and the lane picks its result, so those loops are
+// vector code. the rest runs lane by lane. CompressorBenchmark --bank reports the speed and the
+// difference, which is -inf dB.
+// the control rate decimation of Compressor::set_decimation is not mirrored, lanes always run per sample,
+// the detector is never oversampled, always takes the peak and there is no metering.
+template <int Lanes>
+class CompressorBank
+{
+
+public:
+
+	// the predelay rings are sized for SF_COMPRESSOR_MAXPREDELAY at samplerate
+	CompressorBank(int instances, int samplerate = 48000);
+	~CompressorBank();
+	int inline getNumInstances() { return numinstances; }
+	// copies the settings and the current state of a configured Compressor into one lane. the lanes
+	// share one chunk grid, so instances copied from compressors that were run together stay exact
+	void setInstance(int index, const Compressor& comp);
+	// processes one stereo buffer per instance in place, lptrs/rptrs hold getNumInstances() pointers
+	void processBuffers(float* const* lptrs, float* const* rptrs, int numsamples);
+
+private:
+
+	static constexpr size_t lanewidth = (size_t)Lanes; // the bound of every per-lane array
+
+	struct alignas(64) LaneGroup
+	{
+		// coefficients
+		float linearpregain[lanewidth];
+		int curve[lanewidth]; // Compressor::CurveKernel the compressor would run
+		float threshold[lanewidth];
+		float knee[lanewidth];
+		float slope[lanewidth];
+		float k[lanewidth];
+		float kneedboffset[lanewidth];
+		float linearthreshold[lanewidth];
+		float linearthresholdknee[lanewidth];
+		float a[lanewidth]; // adaptive release polynomial coefficients
+		float b[lanewidth];
+		float c[lanewidth];
+		float d[lanewidth];
+		float attacksamplesinv[lanewidth];
+		float satreleasesamplesinv[lanewidth];
+		bool fullwet[lanewidth]; // wet 1 and dry 0, the gain is mastergain * gain
+		float mastergain[lanewidth];
+		float wetgain[lanewidth]; // wet * mastergain
+		float dry[lanewidth];
+
+		// state
+		float detectoravg[lanewidth];
+		float compgain[lanewidth];
+		float maxcompdiffdb[lanewidth];
+		float enveloperate[lanewidth];
+		float scaleddesiredgain[lanewidth];
+		int delaysamples[lanewidth];
+		int delaywritepos[lanewidth];
+	};
+
+	void setLane(int index, const Compressor& comp);
+	float curveAttenuation(const LaneGroup& g, int lane, float inputmax);
+	void calculateEnvelopeRate(LaneGroup& g);
+	void detectorPass(LaneGroup& g, float* const* lptrs, float* const* rptrs, int firstlane, int numsamples);
+	void envelopePass(LaneGroup& g, int numsamples);
+	void gainPass(LaneGroup& g, float* const* lptrs, float* const* rptrs, int firstlane, int numsamples);
+
+	// Compressor::fixf without the debug output
+	static inline float fixf(float v, float def) {
+		return std::isnan(v) || std::isinf(v) ? def : v;
+	}
+
+	int numinstances;
+	int numlanes; // numinstances rounded up to a whole group
+	std::vector<LaneGroup> groups;
+	std::vector<float> curvetables; // SF_COMPRESSOR_CURVETABLESIZE per lane, read by the lanes with set_fastmath
+	// predelay rings, delaymask + 1 interleaved stereo frames per lane
+	void* delaymem;
+	float* delaybuf;
+	int delaymask;
+	int samplepos;
+	int chunkphase = 0; // see Compressor::chunkphase
+
+	// per-chunk scratch, indexed [sample][lane]
+	float prebufL[SF_COMPRESSOR_SPU][lanewidth]; float prebufR[SF_COMPRESSOR_SPU][lanewidth];
+	float attenuationbuf[SF_COMPRESSOR_SPU][lanewidth];
+	float gainbuf[SF_COMPRESSOR_SPU][lanewidth];
+	float delayframes[SF_COMPRESSOR_SPU * 2]; // one lane's chunk to and from its ring
+};
@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    LoadMonitor.cpp
+    Created: 17 Oct 2026 9:12:44pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#include "LoadMonitor.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+ #include <intrin.h>
+ #define LOADMONITOR_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+ #include <x86intrin.h>
+ #define LOADMONITOR_HAS_TSC 1
+#else
+ #define LOADMONITOR_HAS_TSC 0
+#endif
+
+LoadMonitor::LoadMonitor()
+{
+    for (auto& bin : bins)
+    {
+        bin.store(0, std::memory_order_relaxed);
+    }
+}
+
+juce::uint64 LoadMonitor::readcyclecounter()
+{
+#if LOADMONITOR_HAS_TSC
+    return __rdtsc();
+#else
+    return (juce::uint64)juce::Time::getHighResolutionTicks();
+#endif
+}
+
+double LoadMonitor::cyclesPerSecond()
+{
+#if LOADMONITOR_HAS_TSC
+    // the tsc rate is not reported anywhere portable, so it is timed against the high resolution clock
+    static const double rate = []
+    {
+        juce::int64 starttime = juce::Time::getHighResolutionTicks();
+        juce::uint64 startcycles = __rdtsc();
+        juce::int64 now;
+        do
+        {
+            now = juce::Time::getHighResolutionTicks();
+        } while (juce::Time::highResolutionTicksToSeconds(now - starttime) < 0.005);
+        juce::uint64 cycles = __rdtsc() - startcycles;
+        return (double)cycles / juce::Time::highResolutionTicksToSeconds(now - starttime);
+    }();
+    return rate;
+#else
+    return (double)juce::Time::getHighResolutionTicksPerSecond();
+#endif
+}
+
+void LoadMonitor::prepare(double samplerate)
+{
+    cyclespersample = cyclesPerSecond() / samplerate;
+    reset();
+}
+
+void LoadMonitor::end(juce::uint64 start, int numsamples)
+{
+    juce::uint64 cycles = readcyclecounter() - start;
+    if (numsamples <= 0 || cyclespersample <= 0.0)
+    {
+        return;
+    }
+    if (resetrequested.load(std::memory_order_relaxed))
+    {
+        resetrequested.store(false, std::memory_order_relaxed);
+        for (auto& bin : bins)
+        {
+            bin.store(0, std::memory_order_relaxed);
+        }
+        blocks.store(0, std::memory_order_relaxed);
+        overruns.store(0, std::memory_order_relaxed);
+        loadsum.store(0.0, std::memory_order_relaxed);
+        worst.store(0.0f, std::memory_order_relaxed);
+    }
+
+    float load = (float)((double)cycles / (cyclespersample * numsamples));
+    int bin = (int)(load * (SF_COMPRESSOR_LOADBINS / SF_COMPRESSOR_LOADRANGE));
+    bin = bin < SF_COMPRESSOR_LOADBINS - 1 ? bin : SF_COMPRESSOR_LOADBINS - 1;
+
+    // single writer: plain load and store instead of fetch_add
+    bins[bin].store(bins[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    blocks.store(blocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    loadsum.store(loadsum.load(std::memory_order_relaxed) + load, std::memory_order_relaxed);
+    if (load > worst.load(std::memory_order_relaxed))
+    {
+        worst.store(load, std::memory_order_relaxed);
+    }
+    if (load > overrunbudget.load(std::memory_order_relaxed))
+    {
+        overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+LoadMonitor::Stats LoadMonitor::getStats() const
+{
+    // the fields are read one by one, so a block finishing meanwhile may be counted in some and not others
+    Stats stats;
+    stats.blocks = blocks.load(std::memory_order_relaxed);
+    stats.overruns = overruns.load(std::memory_order_relaxed);
+    stats.mean = stats.blocks > 0 ? (float)(loadsum.load(std::memory_order_relaxed) / stats.blocks) : 0.0f;
+    stats.worst = worst.load(std::memory_order_relaxed);
+
+    // upper edge of the bin that holds the 99th percentile
+    stats.p99 = 0.0f;
+    juce::uint64 target = stats.blocks - stats.blocks / 100;
+    juce::uint64 count = 0;
+    for (int i = 0; i < SF_COMPRESSOR_LOADBINS && stats.blocks > 0; i++)
+    {
+        count += bins[i].load(std::memory_order_relaxed);
+        if (count >= target)
+        {
+            stats.p99 = (float)(i + 1) * (SF_COMPRESSOR_LOADRANGE / SF_COMPRESSOR_LOADBINS);
+            break;
+        }
+    }
+    return stats;
+}
+
+juce::String LoadMonitor::dump() const
+{
+    Stats stats = getStats();
+    juce::String text;
+    text << "blocks " << (juce::int64)stats.blocks << ", overruns " << (juce::int64)stats.overruns
+         << ", load mean " << juce::String(stats.mean * 100.0f, 2) << "%, p99 "
+         << juce::String(stats.p99 * 100.0f, 2) << "%, worst " << juce::String(stats.worst * 100.0f, 2) << "%\n";
+    for (int i = 0; i < SF_COMPRESSOR_LOADBINS; i++)
+    {
+        juce::uint64 count = getBin(i);
+        if (count > 0)
+        {
+            text << "  " << juce::String(i * (100.0f * SF_COMPRESSOR_LOADRANGE / SF_COMPRESSOR_LOADBINS), 2)
+                 << (i == SF_COMPRESSOR_LOADBINS - 1 ? "% and up: " : "%: ") << (juce::int64)count << "\n";
+        }
+    }
+    return text;
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    LoadMonitor.h
+    Created: 17 Oct 2026 9:12:44pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+
+// set to 0 to compile the processBlock timing out of the plugin completely
+#ifndef SF_COMPRESSOR_LOADMONITOR
+ #define SF_COMPRESSOR_LOADMONITOR 1
+#endif
+
+// histogram of block processing time as a fraction of the block's real-time budget (its length in
+// seconds). SF_COMPRESSOR_LOADBINS bins cover 0 up to SF_COMPRESSOR_LOADRANGE times the budget, the
+// last bin also collects everything slower than that
+#define SF_COMPRESSOR_LOADBINS  128
+#define SF_COMPRESSOR_LOADRANGE 2.0f
+
+// per-block cpu load of one processor instance. the audio thread timestamps each block with the cpu
+// cycle counter and files it into the histogram, any other thread reads the statistics without
+// locking. the audio thread is the only writer, so it never needs an atomic read-modify-write
+class LoadMonitor
+{
+
+public:
+
+    struct Stats
+    {
+        juce::uint64 blocks; // blocks measured since the last reset
+        juce::uint64 overruns; // blocks that took longer than the overrun budget
+        float mean; // load as a fraction of the real-time budget
+        float p99;
+        float worst;
+    };
+
+    LoadMonitor();
+
+    // message thread, before processing starts
+    void prepare(double samplerate);
+    // blocks that take longer than this fraction of their real-time budget count as overruns
+    void setOverrunBudget(float fraction) { overrunbudget.store(fraction, std::memory_order_relaxed); }
+
+    // audio thread, around the processing of one block
+    static inline juce::uint64 begin() { return readcyclecounter(); }
+    void end(juce::uint64 start, int numsamples);
+
+    // any thread
+    Stats getStats() const;
+    juce::uint64 getBin(int bin) const { return bins[bin].load(std::memory_order_relaxed); }
+    // the audio thread clears the statistics at its next block
+    void reset() { resetrequested.store(true, std::memory_order_relaxed); }
+    // one line of statistics and the non-empty histogram bins, for logging
+    juce::String dump() const;
+
+private:
+
+    static juce::uint64 readcyclecounter();
+    // cycle counter ticks per second, measured once per process
+    static double cyclesPerSecond();
+
+    double cyclespersample = 0.0;
+    std::atomic<float> overrunbudget { 1.0f };
+    std::atomic<bool> resetrequested { false };
+
+    std::atomic<juce::uint64> bins[SF_COMPRESSOR_LOADBINS];
+    std::atomic<juce::uint64> blocks { 0 };
+    std::atomic<juce::uint64> overruns { 0 };
+    std::atomic<double> loadsum { 0.0 };
+    std::atomic<float> worst { 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE(LoadMonitor)
+};
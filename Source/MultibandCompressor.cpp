@@ -0,0 +1,489 @@
+/*
+  ==============================================================================
+
+    MultibandCompressor.cpp
+    Created: 17 Oct 2026 10:12:48pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#include "MultibandCompressor.h"
+#include <math.h>
+
+template <typename Sample>
+BasicMultibandCompressor<Sample>::BasicMultibandCompressor()
+{
+    // spread over the spectrum so that any band count gives usable bands
+    const float defaults[SF_MULTIBAND_MAXBANDS - 1] = { 250.0f, 1500.0f, 5000.0f, 12000.0f };
+    for (int i = 0; i < SF_MULTIBAND_MAXBANDS - 1; i++)
+    {
+        design.frequencies[i] = defaults[i];
+    }
+    publish();
+    // nothing is processing yet, so the first snapshot can be taken right away
+    exchange.acquire();
+    live = exchange.getReadBuffer();
+    memset(state1, 0, sizeof(state1));
+    memset(state2, 0, sizeof(state2));
+    // the channel count of a buffer is only known when it comes, so every channel has filter state
+    oversampler.prepare(SF_COMPRESSOR_MAXCHANNELS);
+    keyoversampler.prepare(SF_COMPRESSOR_MAXCHANNELS, false);
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::prepare(int sr_in, int numchannels, float maxpredelay, int factor)
+{
+    factor = Oversampler::normalize(factor);
+    bool refactored = factor != oversampling;
+    oversampling = factor;
+    sampleRate = sr_in * oversampling;
+    for (Band& band : bands)
+    {
+        band.prepare(sampleRate, numchannels, maxpredelay);
+    }
+    oversampler.set_factor(oversampling);
+    keyoversampler.set_factor(oversampling);
+    publish();
+    if (refactored)
+    {
+        // the chunk grid of the bands has to start over on a multiple of the new factor
+        reset();
+    }
+}
+
+template <typename Sample>
+int BasicMultibandCompressor<Sample>::getLatencySamples()
+{
+    if (oversampling == 1)
+    {
+        return bands[0].getLatencySamples();
+    }
+    // the predelay is a whole number of oversampled samples, rounded to input ones
+    return Oversampler::latencySamples(oversampling) + (bands[0].getLatencySamples() + oversampling / 2) / oversampling;
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::reset()
+{
+    if (exchange.acquire())
+    {
+        live = exchange.getReadBuffer();
+    }
+    activebands = live.numbands;
+    for (Band& band : bands)
+    {
+        band.reset();
+    }
+    memset(state1, 0, sizeof(state1));
+    memset(state2, 0, sizeof(state2));
+    oversampler.reset();
+    keyoversampler.reset();
+    clearMeter();
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::set_bands(int numbands)
+{
+    design.numbands = juce::jlimit(1, SF_MULTIBAND_MAXBANDS, numbands);
+    publish();
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::set_metering(bool enabled)
+{
+    for (Band& band : bands)
+    {
+        band.set_metering(enabled);
+    }
+    design.metering = enabled;
+    publish();
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::set_crossover(int index, float frequency)
+{
+    jassert(index >= 0 && index < SF_MULTIBAND_MAXBANDS - 1);
+    design.frequencies[index] = frequency;
+    publish();
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::setStage(Crossover& c, int stage, int lane, StageType type, float frequency)
+{
+    // 2nd order butterworth sections from the bilinear transform, two of them make a Linkwitz-Riley
+    // lowpass or highpass. the allpass has the same poles, it is what the lowpass and highpass of
+    // one crossover sum to
+    double f = juce::jlimit(10.0, 0.45 * sampleRate / oversampling, (double)frequency);
+    double w = 2.0 * M_PI * f / sampleRate;
+    double cosw = cos(w);
+    double alpha = sin(w) / (2.0 * M_SQRT1_2);
+    double a0 = 1.0 + alpha;
+    double b0, b1, b2;
+    if (type == lowpass)
+    {
+        b0 = (1.0 - cosw) * 0.5;
+        b1 = 1.0 - cosw;
+        b2 = b0;
+    }
+    else if (type == highpass)
+    {
+        b0 = (1.0 + cosw) * 0.5;
+        b1 = -(1.0 + cosw);
+        b2 = b0;
+    }
+    else
+    {
+        b0 = 1.0 - alpha;
+        b1 = -2.0 * cosw;
+        b2 = 1.0 + alpha;
+    }
+    c.b0[stage][lane] = (Sample)(b0 / a0);
+    c.b1[stage][lane] = (Sample)(b1 / a0);
+    c.b2[stage][lane] = (Sample)(b2 / a0);
+    c.a1[stage][lane] = (Sample)(-2.0 * cosw / a0);
+    c.a2[stage][lane] = (Sample)((1.0 - alpha) / a0);
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::publish()
+{
+    Crossover& c = design;
+    int numbands = c.numbands;
+    c.numstages = 2 * (numbands - 1);
+    for (int stage = 0; stage < SF_MULTIBAND_STAGES; stage++)
+    {
+        for (int lane = 0; lane < SF_MULTIBAND_LANES; lane++)
+        {
+            c.b0[stage][lane] = 1.0f;
+            c.b1[stage][lane] = 0.0f;
+            c.b2[stage][lane] = 0.0f;
+            c.a1[stage][lane] = 0.0f;
+            c.a2[stage][lane] = 0.0f;
+        }
+    }
+    // band k: highpasses of the crossovers below, the lowpass of crossover k, allpasses of the ones above
+    for (int band = 0; band < numbands; band++)
+    {
+        int stage = 0;
+        for (int x = 0; x < numbands - 1; x++)
+        {
+            if (x < band)
+            {
+                setStage(c, stage++, band, highpass, c.frequencies[x]);
+                setStage(c, stage++, band, highpass, c.frequencies[x]);
+            }
+            else if (x == band)
+            {
+                setStage(c, stage++, band, lowpass, c.frequencies[x]);
+                setStage(c, stage++, band, lowpass, c.frequencies[x]);
+            }
+            else
+            {
+                setStage(c, stage++, band, allpass, c.frequencies[x]);
+            }
+        }
+    }
+    exchange.getWriteBuffer() = design;
+    exchange.publish();
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::processBuffer(const Sample* const* inputs, Sample* const* outputs, int numchannels,
+    int numsamples, const typename Band::ParameterEvent* events, int numevents)
+{
+    processSidechain(inputs, outputs, numchannels, numsamples, nullptr, 0, events, numevents);
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::processSidechain(const Sample* const* inputs, Sample* const* outputs,
+    int numchannels, int numsamples, const Sample* const* sidechain, int numsidechain,
+    const typename Band::ParameterEvent* events, int numevents)
+{
+    typedef typename Band::ParameterEvent ParameterEvent;
+    if (exchange.acquire())
+    {
+        live = exchange.getReadBuffer();
+    }
+    if (live.numbands != activebands)
+    {
+        // the filters start over, bands that were idle have stale state and start over too, on the
+        // chunk grid of band 0 so that all bands still reach their boundaries together
+        for (int b = activebands; b < live.numbands; b++)
+        {
+            bands[b].reset();
+            bands[b].joinChunkGrid(bands[0]);
+            typename Band::MeterReading stale;
+            while (bands[b].popMeterReading(stale))
+            {
+            }
+        }
+        memset(state1, 0, sizeof(state1));
+        memset(state2, 0, sizeof(state2));
+        clearMeter();
+        activebands = live.numbands;
+    }
+    if (activebands == 1 && oversampling == 1)
+    {
+        // band 0 sees the input itself, its readings need no merging
+        bands[0].processSidechain(inputs, outputs, numchannels, numsamples, sidechain, numsidechain, events, numevents);
+        typename Band::MeterReading reading;
+        while (bands[0].popMeterReading(reading))
+        {
+            meterfifo.push(reading);
+        }
+        return;
+    }
+    numchannels = juce::jmin(numchannels, SF_COMPRESSOR_MAXCHANNELS);
+    numsidechain = juce::jmin(numsidechain, SF_COMPRESSOR_MAXCHANNELS);
+
+    int nextevent = 0;
+    for (samplepos = 0; samplepos < numsamples;)
+    {
+        // whole chunks of the band compressors' grid, so each call ends on a boundary. the bands only
+        // ever see multiples of the factor, so an oversampled chunk is a whole number of input samples
+        int numchunk = juce::jmin((SF_COMPRESSOR_SPU - bands[0].getChunkPhase()) / oversampling, numsamples - samplepos);
+
+        // the events of this chunk, relative to it. every one after its start waits for the next
+        // boundary anyway, so only the latest of each parameter at the start and after it is passed on
+        ParameterEvent latest[2][Band::numparameters];
+        bool found[2][Band::numparameters] = {};
+        // the last chunk takes the events past the end of the buffer as well, the bands hold them
+        bool lastchunk = samplepos + numchunk == numsamples;
+        for (; nextevent < numevents && (events[nextevent].sampleoffset < samplepos + numchunk || lastchunk); nextevent++)
+        {
+            const ParameterEvent& event = events[nextevent];
+            if (event.parameter >= 0 && event.parameter < Band::numparameters)
+            {
+                int later = event.sampleoffset > samplepos ? 1 : 0;
+                // a glide of the event's own is in input samples, the bands count oversampled ones
+                latest[later][event.parameter] = { later, event.parameter, event.value,
+                    event.glidesamples * oversampling };
+                found[later][event.parameter] = true;
+            }
+        }
+        ParameterEvent chunkevents[2 * Band::numparameters];
+        int numchunkevents = 0;
+        for (int later = 0; later < 2; later++)
+        {
+            for (int p = 0; p < Band::numparameters; p++)
+            {
+                if (found[later][p])
+                {
+                    chunkevents[numchunkevents++] = latest[later][p];
+                }
+            }
+        }
+
+        if (live.metering)
+        {
+            meterInput(inputs, numchannels, numchunk);
+        }
+        const Sample* inptrs[SF_COMPRESSOR_MAXCHANNELS];
+        Sample* outptrs[SF_COMPRESSOR_MAXCHANNELS];
+        const Sample* keyptrs[SF_COMPRESSOR_MAXCHANNELS];
+        if (oversampling == 1)
+        {
+            for (int ch = 0; ch < numchannels; ch++)
+            {
+                inptrs[ch] = inputs[ch] + samplepos;
+                outptrs[ch] = outputs[ch] + samplepos;
+            }
+            for (int ch = 0; ch < numsidechain; ch++)
+            {
+                keyptrs[ch] = sidechain[ch] + samplepos;
+            }
+        }
+        else
+        {
+            for (int ch = 0; ch < numchannels; ch++)
+            {
+                oversampler.upsample(ch, inputs[ch] + samplepos, upbuf[ch], numchunk);
+                inptrs[ch] = upbuf[ch];
+                outptrs[ch] = upbuf[ch];
+            }
+            for (int ch = 0; ch < numsidechain; ch++)
+            {
+                keyoversampler.upsample(ch, sidechain[ch] + samplepos, keyupbuf[ch], numchunk);
+                keyptrs[ch] = keyupbuf[ch];
+            }
+        }
+        bandPass(inptrs, outptrs, numchannels, numchunk * oversampling, keyptrs, numsidechain, chunkevents,
+            numchunkevents);
+        if (oversampling > 1)
+        {
+            for (int ch = 0; ch < numchannels; ch++)
+            {
+                oversampler.downsample(ch, upbuf[ch], outputs[ch] + samplepos, numchunk);
+            }
+        }
+        if (live.metering)
+        {
+            // the bands end their metering periods on chunk boundaries, so this chunk is the last of any
+            // reading they just published
+            meterOutput(outputs, numchannels, numchunk);
+            mergeMeters();
+        }
+        samplepos += numchunk;
+    }
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::bandPass(const Sample* const* inputs, Sample* const* outputs, int numchannels,
+    int numsamples, const Sample* const* keys, int numkeys, const typename Band::ParameterEvent* events, int numevents)
+{
+    if (activebands == 1)
+    {
+        bands[0].processSidechain(inputs, outputs, numchannels, numsamples, keys, numkeys, events, numevents);
+        return;
+    }
+    crossoverPass(inputs, numchannels, numsamples);
+    for (int b = 0; b < activebands; b++)
+    {
+        Sample* bandptrs[SF_COMPRESSOR_MAXCHANNELS];
+        for (int ch = 0; ch < numchannels; ch++)
+        {
+            bandptrs[ch] = bandbuf[b][ch];
+        }
+        bands[b].processSidechain(bandptrs, bandptrs, numchannels, numsamples, keys, numkeys, events, numevents);
+    }
+    sumPass(outputs, numchannels, numsamples);
+}
+
+// every sample goes through the stages of all band lanes at once. the lane loops have a fixed length
+// and no dependencies between lanes, so they compile to vector code
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::crossoverPass(const Sample* const* inputs, int numchannels, int numsamples)
+{
+    const Crossover& c = live;
+    int numstages = c.numstages;
+    for (int ch = 0; ch < numchannels; ch++)
+    {
+        const Sample* inptr = inputs[ch];
+        // the state is worked on in locals, which the compiler knows nothing else points to
+        Sample s1[SF_MULTIBAND_STAGES][SF_MULTIBAND_LANES];
+        Sample s2[SF_MULTIBAND_STAGES][SF_MULTIBAND_LANES];
+        memcpy(s1, state1[ch], sizeof(s1));
+        memcpy(s2, state2[ch], sizeof(s2));
+        for (int i = 0; i < numsamples; i++)
+        {
+            Sample x[SF_MULTIBAND_LANES];
+            for (int lane = 0; lane < SF_MULTIBAND_LANES; lane++)
+            {
+                x[lane] = inptr[i];
+            }
+            for (int stage = 0; stage < numstages; stage++)
+            {
+                for (int lane = 0; lane < SF_MULTIBAND_LANES; lane++)
+                {
+                    Sample y = c.b0[stage][lane] * x[lane] + s1[stage][lane];
+                    s1[stage][lane] = c.b1[stage][lane] * x[lane] - c.a1[stage][lane] * y + s2[stage][lane];
+                    s2[stage][lane] = c.b2[stage][lane] * x[lane] - c.a2[stage][lane] * y;
+                    x[lane] = y;
+                }
+            }
+            for (int b = 0; b < activebands; b++)
+            {
+                bandbuf[b][ch][i] = x[b];
+            }
+        }
+        memcpy(state1[ch], s1, sizeof(s1));
+        memcpy(state2[ch], s2, sizeof(s2));
+    }
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::sumPass(Sample* const* outputs, int numchannels, int numsamples)
+{
+    for (int ch = 0; ch < numchannels; ch++)
+    {
+        Sample* outptr = outputs[ch];
+        memcpy(outptr, bandbuf[0][ch], (size_t)numsamples * sizeof(Sample));
+        for (int b = 1; b < activebands; b++)
+        {
+            const Sample* bandptr = bandbuf[b][ch];
+            for (int i = 0; i < numsamples; i++)
+            {
+                outptr[i] += bandptr[i];
+            }
+        }
+    }
+}
+
+// the pointers are the whole buffer, the chunk starts at samplepos
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::meterInput(const Sample* const* inputs, int numchannels, int numsamples)
+{
+    chunkinpeak = 0.0f;
+    chunkinsum = 0.0f;
+    for (int ch = 0; ch < numchannels; ch++)
+    {
+        const Sample* inptr = inputs[ch] + samplepos;
+        for (int i = 0; i < numsamples; i++)
+        {
+            Sample input = std::abs(inptr[i]);
+            chunkinpeak = input > chunkinpeak ? input : chunkinpeak;
+            chunkinsum += input * input;
+        }
+    }
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::meterOutput(Sample* const* outputs, int numchannels, int numsamples)
+{
+    // the bands apply the pregain after the crossover, and the one of this chunk is only known now
+    Sample pregain = (Sample)bands[0].getLivePregain();
+    meterinpeak = juce::jmax(meterinpeak, chunkinpeak * pregain);
+    meterinsum += chunkinsum * pregain * pregain;
+    for (int ch = 0; ch < numchannels; ch++)
+    {
+        const Sample* outptr = outputs[ch] + samplepos;
+        for (int i = 0; i < numsamples; i++)
+        {
+            Sample output = std::abs(outptr[i]);
+            meteroutpeak = output > meteroutpeak ? output : meteroutpeak;
+            meteroutsum += output * output;
+        }
+    }
+    metervalues += numsamples * numchannels;
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::mergeMeters()
+{
+    // the bands run in lockstep, so their readings cover the same periods. only the gain reduction is
+    // taken from them, their levels are those of a band
+    typename Band::MeterReading reading;
+    while (bands[0].popMeterReading(reading))
+    {
+        for (int b = 1; b < activebands; b++)
+        {
+            typename Band::MeterReading other;
+            if (bands[b].popMeterReading(other))
+            {
+                reading.gainreduction = juce::jmin(reading.gainreduction, other.gainreduction);
+            }
+        }
+        Sample norm = metervalues > 0 ? (Sample)1.0f / (Sample)metervalues : (Sample)0.0f;
+        reading.inputpeak = (float)meterinpeak;
+        reading.inputrms = (float)std::sqrt(meterinsum * norm);
+        reading.outputpeak = (float)meteroutpeak;
+        reading.outputrms = (float)std::sqrt(meteroutsum * norm);
+        // a consumer that stopped draining just misses readings, as with a single compressor
+        meterfifo.push(reading);
+        clearMeter();
+    }
+}
+
+template <typename Sample>
+void BasicMultibandCompressor<Sample>::clearMeter()
+{
+    meterinpeak = 0.0f;
+    meterinsum = 0.0f;
+    meteroutpeak = 0.0f;
+    meteroutsum = 0.0f;
+    metervalues = 0;
+}
+
+template class BasicMultibandCompressor<float>;
+template class BasicMultibandCompressor<double>;
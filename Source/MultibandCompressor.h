@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    MultibandCompressor.h
+    Created: 17 Oct 2026 10:12:48pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "Compressor.h"
+#include "Oversampler.h"
+
+// most bands one multiband compressor splits its input into
+#define SF_MULTIBAND_MAXBANDS 5
+
+// band lanes of the crossover filters, SF_MULTIBAND_MAXBANDS rounded up to a full vector
+#define SF_MULTIBAND_LANES    8
+
+// biquads per band, enough for the top band of SF_MULTIBAND_MAXBANDS bands, see below
+#define SF_MULTIBAND_STAGES   (2 * (SF_MULTIBAND_MAXBANDS - 1))
+
+// splits the input into 1 to SF_MULTIBAND_MAXBANDS bands with 4th order Linkwitz-Riley crossovers and
+// runs every band through a BasicCompressor of its own, with its own gain computer, adaptive release
+// and predelay. the compressed bands are summed back into the output.
+//
+// every band is filtered straight from the input: band k is the lowpass of crossover k after the
+// highpasses of all crossovers below it and the allpasses of all crossovers above it. all bands then
+// carry the same phase, the product of the crossover allpasses, so they sum back flat. and because
+// each band is a fixed cascade of biquads, the bands are the lanes of one vector filter that is run
+// once per sample, padded with pass-through stages to a common length.
+//
+// the buffer is processed a chunk at a time on the compressors' SF_COMPRESSOR_SPU grid: the crossover
+// fills the band chunks, each band compressor processes its chunk in place, and the bands are summed
+// into the output, so one pass over the buffer does it all. with one band the crossover is skipped
+// and band 0 processes the buffer directly, exactly like a plain compressor.
+//
+// oversampled, every chunk is upsampled before the crossover and downsampled after the sum, so the
+// detectors see the peaks between the input samples and the gain changes of fast attacks are
+// filtered out above the input band instead of aliasing back into it. the crossovers and the bands
+// then run at the oversampled rate, which costs the factor in CPU and adds the delay of the
+// resampling filters, see BasicOversampler::latencySamples.
+//
+// threading is the same as for BasicCompressor: set_bands, set_crossover, prepare and the set_*
+// functions of the bands belong to the message thread, processBuffer and reset to the audio thread.
+// a change of the band count is not click free
+template <typename Sample>
+class BasicMultibandCompressor
+{
+
+public:
+
+	typedef BasicCompressor<Sample> Band;
+
+	BasicMultibandCompressor();
+	// prepares every band, also the ones not in use, and designs the crossovers for sr_in. with an
+	// oversampling factor of 2, 4 or 8 the crossovers and the bands run at sr_in times that; it is
+	// only set here because the bands allocate for their rate. a new factor resets the engine
+	void prepare(int sr_in, int numchannels, float maxpredelay = SF_COMPRESSOR_MAXPREDELAY, int factor = 1);
+	// clears the crossover filters and every band
+	void reset();
+	// events go to every band in use, as for BasicCompressor::processBuffer
+	void processBuffer(const Sample* const* inputs, Sample* const* outputs, int numchannels, int numsamples,
+		const typename Band::ParameterEvent* events = nullptr, int numevents = 0);
+	// the detectors of every band listen to the whole sidechain, not to a band of it, see
+	// BasicCompressor::processSidechain. a key drives all bands, as for ducking
+	void processSidechain(const Sample* const* inputs, Sample* const* outputs, int numchannels, int numsamples,
+		const Sample* const* sidechain, int numsidechain, const typename Band::ParameterEvent* events = nullptr,
+		int numevents = 0);
+	// 1 to SF_MULTIBAND_MAXBANDS, bands that come into use start from a reset
+	void set_bands(int numbands);
+	int inline getNumBands() { return design.numbands; }
+	// the crossover between band index and band index + 1 in Hz, clamped to 10 Hz..0.45 * sample rate,
+	// the input sample rate when oversampling.
+	// the bands sum back flat for any frequencies, ascending ones give the usual low to high bands
+	void set_crossover(int index, float frequency);
+	float inline getCrossover(int index) { return design.frequencies[index]; }
+	// the compressor of one band, its set_* functions configure that band alone. when oversampling,
+	// it runs at the oversampled rate and its times and latency are in samples of that rate
+	Band& getBand(int band) { return bands[band]; }
+	int inline getOversampling() { return oversampling; }
+	// the bands should share one predelay, band 0 reports it. oversampled, in input samples and with
+	// the delay of the resampling filters
+	int getLatencySamples();
+	// switches the metering of every band on or off, and the engine's own metering of its input and
+	// output. only while a consumer drains the readings
+	void set_metering(bool enabled);
+	// one reading per metering period of the bands: the largest gain reduction of any band in use,
+	// and the levels of the input, after the pregain of band 0, before the crossover, and of the
+	// summed output. the audio thread merges them as the bands produce them, so the consumer only
+	// takes from the queue of the engine. false when no reading is waiting
+	bool popMeterReading(typename Band::MeterReading& reading) { return meterfifo.pop(reading); }
+
+private:
+
+	// one complete crossover and the metering switch, published like the compressor coefficients
+	struct Crossover
+	{
+		bool metering = false;
+		int numbands = 1;
+		int numstages = 0; // biquads in use per lane, 2 * (numbands - 1)
+		float frequencies[SF_MULTIBAND_MAXBANDS - 1];
+		// transposed direct form II coefficients, normalized to a0 = 1, per stage and lane
+		Sample b0[SF_MULTIBAND_STAGES][SF_MULTIBAND_LANES];
+		Sample b1[SF_MULTIBAND_STAGES][SF_MULTIBAND_LANES];
+		Sample b2[SF_MULTIBAND_STAGES][SF_MULTIBAND_LANES];
+		Sample a1[SF_MULTIBAND_STAGES][SF_MULTIBAND_LANES];
+		Sample a2[SF_MULTIBAND_STAGES][SF_MULTIBAND_LANES];
+	};
+	enum StageType { lowpass, highpass, allpass };
+
+	// recomputes the filter coefficients of the design and hands it to the audio thread
+	void publish();
+	void setStage(Crossover& c, int stage, int lane, StageType type, float frequency);
+	// one chunk of the band compressors' grid through the crossover, the bands and the sum, at the
+	// processing rate. the pointers start at the chunk
+	void bandPass(const Sample* const* inputs, Sample* const* outputs, int numchannels, int numsamples,
+		const Sample* const* keys, int numkeys, const typename Band::ParameterEvent* events, int numevents);
+	void crossoverPass(const Sample* const* inputs, int numchannels, int numsamples);
+	void sumPass(Sample* const* outputs, int numchannels, int numsamples);
+	// the levels of one chunk at the input rate, for the merged readings. the input is taken before
+	// the chunk is processed, which may be in place, and the output after it
+	void meterInput(const Sample* const* inputs, int numchannels, int numsamples);
+	void meterOutput(Sample* const* outputs, int numchannels, int numsamples);
+	// moves the readings the bands have published into meterfifo, merged with the engine's levels
+	void mergeMeters();
+	void clearMeter();
+
+	int sampleRate = 48000; // processing rate, oversampled
+	int oversampling = 1;
+	Crossover design; // message thread copy
+	TripleBuffer<Crossover> exchange;
+	Crossover live; // audio thread copy
+
+	Band bands[SF_MULTIBAND_MAXBANDS];
+	int activebands = 1; // bands processed in the last buffer, audio thread only
+	int samplepos = 0;
+
+	// filter state per channel, stage and lane
+	Sample state1[SF_COMPRESSOR_MAXCHANNELS][SF_MULTIBAND_STAGES][SF_MULTIBAND_LANES];
+	Sample state2[SF_COMPRESSOR_MAXCHANNELS][SF_MULTIBAND_STAGES][SF_MULTIBAND_LANES];
+	// one chunk of every band, filtered and then compressed in place
+	Sample bandbuf[SF_MULTIBAND_MAXBANDS][SF_COMPRESSOR_MAXCHANNELS][SF_COMPRESSOR_SPU];
+
+	// the input up and the sum back down, and the sidechain up only
+	BasicOversampler<Sample> oversampler;
+	BasicOversampler<Sample> keyoversampler;
+	// one oversampled chunk of the input, processed in place, and of the sidechain
+	Sample upbuf[SF_COMPRESSOR_MAXCHANNELS][SF_COMPRESSOR_SPU];
+	Sample keyupbuf[SF_COMPRESSOR_MAXCHANNELS][SF_COMPRESSOR_SPU];
+
+	// levels since the last merged reading, the sums over all channels
+	Sample chunkinpeak = 0.0f; // the input of the current chunk, before the pregain
+	Sample chunkinsum = 0.0f;
+	Sample meterinpeak = 0.0f;
+	Sample meterinsum = 0.0f;
+	Sample meteroutpeak = 0.0f;
+	Sample meteroutsum = 0.0f;
+	int metervalues = 0; // samples times channels in the sums
+	SpscFifo<typename Band::MeterReading, SF_COMPRESSOR_METERFIFOSIZE> meterfifo;
+};
+
+typedef BasicMultibandCompressor<float> MultibandCompressor;
+typedef BasicMultibandCompressor<double> MultibandCompressorDouble;
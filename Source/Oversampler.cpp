@@ -0,0 +1,278 @@
+/*
+  ==============================================================================
+
+    Oversampler.cpp
+    Created: 17 Oct 2026 11:02:15pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#include "Oversampler.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+// scratch for one stage: the history and the longest block any stage sees
+#define SF_OVERSAMPLER_SCRATCH (4 * SF_OVERSAMPLER_STAGE0TAPS + SF_OVERSAMPLER_MAXBLOCK * SF_OVERSAMPLER_MAXFACTOR)
+
+template <typename Sample>
+BasicOversampler<Sample>::BasicOversampler()
+{
+    design(stages[0], SF_OVERSAMPLER_STAGE0TAPS, 7.0);
+    design(stages[1], SF_OVERSAMPLER_STAGE1TAPS, 7.0);
+    design(stages[2], SF_OVERSAMPLER_STAGE2TAPS, 7.0);
+    for (int s = 0; s < SF_OVERSAMPLER_STAGES; s++)
+    {
+        stages[s].uphistory = upstride;
+        stages[s].downhistory = downstride;
+        upstride += 2 * stages[s].taps - 1;
+        downstride += 4 * stages[s].taps - 2;
+    }
+}
+
+template <typename Sample>
+void BasicOversampler<Sample>::design(Stage& stage, int taps, double beta)
+{
+    // the interpolating phase of a windowed sinc with its cutoff at half the band: tap 2t + 1 off the
+    // centre is (-1)^t / (pi (2t + 1)), the even ones besides the centre are zero
+    auto bessel = [](double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; term > 1e-12 * sum; k++)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    };
+    double centre = 2.0 * taps - 1.0;
+    double coefficients[SF_OVERSAMPLER_STAGE0TAPS];
+    double sum = 0.0;
+    for (int t = 0; t < taps; t++)
+    {
+        double m = 2.0 * t + 1.0;
+        double window = bessel(beta * sqrt(1.0 - (m / centre) * (m / centre))) / bessel(beta);
+        coefficients[t] = ((t & 1) ? -1.0 : 1.0) / (M_PI * m) * window;
+        sum += coefficients[t];
+    }
+    // exactly unity gain at DC, the pass-through phase carries the other half
+    stage.taps = taps;
+    for (int t = 0; t < taps; t++)
+    {
+        stage.coefficients[t] = (Sample)(coefficients[t] * 0.5 / sum);
+    }
+}
+
+template <typename Sample>
+void BasicOversampler<Sample>::prepare(int channels, bool downsampling)
+{
+    numchannels = channels;
+    uphistory.assign((size_t)channels * (size_t)upstride, (Sample)0.0f);
+    downhistory.assign(downsampling ? (size_t)channels * (size_t)downstride : 0, (Sample)0.0f);
+    padhistory.assign(downsampling ? (size_t)channels * SF_OVERSAMPLER_MAXFACTOR : 0, (Sample)0.0f);
+}
+
+template <typename Sample>
+void BasicOversampler<Sample>::set_factor(int newfactor)
+{
+    factor = normalize(newfactor);
+    reset();
+}
+
+template <typename Sample>
+void BasicOversampler<Sample>::reset()
+{
+    std::fill(uphistory.begin(), uphistory.end(), (Sample)0.0f);
+    std::fill(downhistory.begin(), downhistory.end(), (Sample)0.0f);
+    std::fill(padhistory.begin(), padhistory.end(), (Sample)0.0f);
+}
+
+template <typename Sample>
+int BasicOversampler<Sample>::normalize(int factor)
+{
+    int supported = 1;
+    while (supported * 2 <= factor && supported < SF_OVERSAMPLER_MAXFACTOR)
+    {
+        supported *= 2;
+    }
+    return supported;
+}
+
+template <typename Sample>
+int BasicOversampler<Sample>::stagesFor(int factor)
+{
+    int numstages = 0;
+    for (int f = normalize(factor); f > 1; f /= 2)
+    {
+        numstages++;
+    }
+    return numstages;
+}
+
+template <typename Sample>
+double BasicOversampler<Sample>::upsampleDelay(int factor)
+{
+    // every stage delays by its centre tap, 2 * K - 1 samples at its output rate
+    const int taps[SF_OVERSAMPLER_STAGES] = { SF_OVERSAMPLER_STAGE0TAPS, SF_OVERSAMPLER_STAGE1TAPS,
+        SF_OVERSAMPLER_STAGE2TAPS };
+    double delay = 0.0;
+    for (int s = 0; s < stagesFor(factor); s++)
+    {
+        delay += (2.0 * taps[s] - 1.0) / (double)(2 << s);
+    }
+    return delay;
+}
+
+template <typename Sample>
+int BasicOversampler<Sample>::paddingFor(int factor)
+{
+    // the delay of both directions at the top rate
+    factor = normalize(factor);
+    int topdelay = (int)lround(2.0 * upsampleDelay(factor) * factor);
+    return (factor - topdelay % factor) % factor;
+}
+
+template <typename Sample>
+int BasicOversampler<Sample>::latencySamples(int factor)
+{
+    factor = normalize(factor);
+    int topdelay = (int)lround(2.0 * upsampleDelay(factor) * factor);
+    return (topdelay + paddingFor(factor)) / factor;
+}
+
+template <typename Sample>
+void BasicOversampler<Sample>::upsample(int channel, const Sample* input, Sample* output, int numsamples)
+{
+    if (factor == 1)
+    {
+        memcpy(output, input, (size_t)numsamples * sizeof(Sample));
+        return;
+    }
+    int numstages = stagesFor(factor);
+    Sample scratch[2][SF_OVERSAMPLER_MAXBLOCK * SF_OVERSAMPLER_MAXFACTOR];
+    Sample* history = uphistory.data() + (size_t)channel * (size_t)upstride;
+    const Sample* in = input;
+    for (int s = 0; s < numstages; s++)
+    {
+        Sample* out = s == numstages - 1 ? output : scratch[s & 1];
+        upStage(stages[s], history + stages[s].uphistory, in, out, numsamples << s);
+        in = out;
+    }
+}
+
+template <typename Sample>
+void BasicOversampler<Sample>::downsample(int channel, const Sample* input, Sample* output, int numsamples)
+{
+    if (factor == 1)
+    {
+        memcpy(output, input, (size_t)numsamples * sizeof(Sample));
+        return;
+    }
+    int numstages = stagesFor(factor);
+    int topsamples = numsamples * factor;
+    Sample scratch[2][SF_OVERSAMPLER_MAXBLOCK * SF_OVERSAMPLER_MAXFACTOR];
+    const Sample* in = input;
+
+    // the padding delay goes first, at the top rate
+    int padding = paddingFor(factor);
+    Sample padded[SF_OVERSAMPLER_MAXFACTOR + SF_OVERSAMPLER_MAXBLOCK * SF_OVERSAMPLER_MAXFACTOR];
+    if (padding > 0)
+    {
+        Sample* pad = padhistory.data() + (size_t)channel * SF_OVERSAMPLER_MAXFACTOR;
+        memcpy(padded, pad, (size_t)padding * sizeof(Sample));
+        memcpy(padded + padding, input, (size_t)topsamples * sizeof(Sample));
+        memcpy(pad, padded + topsamples, (size_t)padding * sizeof(Sample));
+        in = padded;
+    }
+
+    Sample* history = downhistory.data() + (size_t)channel * (size_t)downstride;
+    for (int s = numstages - 1; s >= 0; s--)
+    {
+        Sample* out = s == 0 ? output : scratch[s & 1];
+        downStage(stages[s], history + stages[s].downhistory, in, out, numsamples << s);
+        in = out;
+    }
+}
+
+// one doubling. the odd outputs are the input delayed by the centre tap, the even ones are
+// interpolated from the K samples on either side
+template <typename Sample>
+void BasicOversampler<Sample>::upStage(const Stage& stage, Sample* history, const Sample* input, Sample* output,
+    int numsamples)
+{
+    int taps = stage.taps;
+    int historysize = 2 * taps - 1;
+    Sample ext[SF_OVERSAMPLER_SCRATCH];
+    memcpy(ext, history, (size_t)historysize * sizeof(Sample));
+    memcpy(ext + historysize, input, (size_t)numsamples * sizeof(Sample));
+
+    Sample even[SF_OVERSAMPLER_MAXBLOCK * SF_OVERSAMPLER_MAXFACTOR / 2];
+    for (int i = 0; i < numsamples; i++)
+    {
+        even[i] = 0.0f;
+    }
+    for (int t = 0; t < taps; t++)
+    {
+        Sample c = stage.coefficients[t];
+        const Sample* later = ext + taps + t;
+        const Sample* earlier = ext + taps - 1 - t;
+        for (int i = 0; i < numsamples; i++)
+        {
+            even[i] += c * (later[i] + earlier[i]);
+        }
+    }
+    for (int i = 0; i < numsamples; i++)
+    {
+        output[2 * i] = even[i];
+        output[2 * i + 1] = ext[i + taps];
+    }
+    memcpy(history, ext + numsamples, (size_t)historysize * sizeof(Sample));
+}
+
+// one halving, 2 * numsamples in. the input is split into its phases first, so the filter runs on
+// contiguous samples: the even phase through the interpolating taps, the odd one through the centre
+template <typename Sample>
+void BasicOversampler<Sample>::downStage(const Stage& stage, Sample* history, const Sample* input, Sample* output,
+    int numsamples)
+{
+    int taps = stage.taps;
+    int historysize = 4 * taps - 2;
+    Sample ext[SF_OVERSAMPLER_SCRATCH];
+    memcpy(ext, history, (size_t)historysize * sizeof(Sample));
+    memcpy(ext + historysize, input, (size_t)(2 * numsamples) * sizeof(Sample));
+    memcpy(history, ext + 2 * numsamples, (size_t)historysize * sizeof(Sample));
+
+    int phasesize = historysize / 2 + numsamples;
+    Sample even[SF_OVERSAMPLER_SCRATCH / 2];
+    Sample odd[SF_OVERSAMPLER_SCRATCH / 2];
+    for (int k = 0; k < phasesize; k++)
+    {
+        even[k] = ext[2 * k];
+        odd[k] = ext[2 * k + 1];
+    }
+
+    Sample sum[SF_OVERSAMPLER_MAXBLOCK * SF_OVERSAMPLER_MAXFACTOR / 2];
+    for (int i = 0; i < numsamples; i++)
+    {
+        sum[i] = odd[i + taps - 1];
+    }
+    for (int t = 0; t < taps; t++)
+    {
+        Sample c = stage.coefficients[t];
+        const Sample* later = even + taps + t;
+        const Sample* earlier = even + taps - 1 - t;
+        for (int i = 0; i < numsamples; i++)
+        {
+            sum[i] += c * (later[i] + earlier[i]);
+        }
+    }
+    // the interpolating coefficients are twice the filter taps, and so is the centre tap of 0.5
+    for (int i = 0; i < numsamples; i++)
+    {
+        output[i] = sum[i] * (Sample)0.5f;
+    }
+}
+
+template class BasicOversampler<float>;
+template class BasicOversampler<double>;
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    Oversampler.h
+    Created: 17 Oct 2026 11:02:15pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+// largest oversampling factor, 2^SF_OVERSAMPLER_STAGES
+#define SF_OVERSAMPLER_MAXFACTOR 8
+#define SF_OVERSAMPLER_STAGES    3
+
+// most base rate samples one upsample or downsample call may take, the compressor chunk size
+#define SF_OVERSAMPLER_MAXBLOCK  32
+
+// half-band FIR of each doubling: 4 * K - 1 taps, K of them distinct and nonzero besides the centre.
+// kaiser windowed, the first stage has the narrow transition band from 0.45 to 0.55 of the base rate,
+// the later ones only have to clear the images of what is left. at every factor the passband up to
+// 0.45 of the base rate is flat within 0.005 dB and the images and aliases are at least 70 dB down
+#define SF_OVERSAMPLER_STAGE0TAPS 24
+#define SF_OVERSAMPLER_STAGE1TAPS 7
+#define SF_OVERSAMPLER_STAGE2TAPS 6
+
+// changes the sample rate of a block by 2, 4 or 8 with a cascade of linear phase half-band filters,
+// one per doubling. every doubling is polyphase: upsampling passes one phase through delayed and
+// filters the other, downsampling filters the even input samples and adds the centre tap of the odd
+// ones. half the taps are zero and never computed, and the loops run over the samples of the block
+// so they compile to vector code.
+//
+// the state of every channel is carried across calls, so the output does not depend on the block
+// sizes. latencySamples is the delay of an upsample followed by a downsample; downsample pads the
+// top rate so that it comes to whole base rate samples, which a host can compensate exactly
+template <typename Sample>
+class BasicOversampler
+{
+
+public:
+
+	BasicOversampler();
+	// sizes the filter state for channels channels, the downsampling state only when downsampling
+	// is used. allocates, so it belongs before processing starts
+	void prepare(int channels, bool downsampling = true);
+	// 1, 2, 4 or 8, other values are rounded down to a power of two. clears the filter state but
+	// does not allocate, so it may be called from the audio thread
+	void set_factor(int newfactor);
+	int inline getFactor() const { return factor; }
+	void reset();
+	// numsamples base rate samples of one channel in, numsamples * factor samples out. numsamples is
+	// at most SF_OVERSAMPLER_MAXBLOCK
+	void upsample(int channel, const Sample* input, Sample* output, int numsamples);
+	// numsamples * factor samples of one channel in, numsamples base rate samples out
+	void downsample(int channel, const Sample* input, Sample* output, int numsamples);
+	// factor rounded down to a supported one
+	static int normalize(int factor);
+	// delay of upsample alone, in base rate samples. not a whole number of them
+	static double upsampleDelay(int factor);
+	// delay of upsample followed by downsample, in base rate samples
+	static int latencySamples(int factor);
+
+private:
+
+	struct Stage
+	{
+		int taps; // K, distinct coefficients
+		Sample coefficients[SF_OVERSAMPLER_STAGE0TAPS]; // interpolating phase, summing to 0.5
+		int uphistory; // offset of this stage in a channel's upsampling history, 2 * K - 1 samples
+		int downhistory; // offset in the downsampling history, 4 * K - 2 samples
+	};
+
+	static int stagesFor(int factor);
+	// top rate samples downsample delays by, so that latencySamples is whole
+	static int paddingFor(int factor);
+	static void design(Stage& stage, int taps, double beta);
+	static void upStage(const Stage& stage, Sample* history, const Sample* input, Sample* output, int numsamples);
+	static void downStage(const Stage& stage, Sample* history, const Sample* input, Sample* output, int numsamples);
+
+	Stage stages[SF_OVERSAMPLER_STAGES];
+	int factor = 1;
+	int numchannels = 0;
+	int upstride = 0; // history samples per channel
+	int downstride = 0;
+	std::vector<Sample> uphistory;
+	std::vector<Sample> downhistory;
+	std::vector<Sample> padhistory; // SF_OVERSAMPLER_MAXFACTOR top rate samples per channel
+};
+
+typedef BasicOversampler<float> Oversampler;
+typedef BasicOversampler<double> OversamplerDouble;
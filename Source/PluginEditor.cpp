@@ -15,7 +15,7 @@ CompressorImplementationAudioProcessorEditor::CompressorImplementationAudioProce
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (500, 300);
+    setSize (500, 380);
 
     // make all visible
     addAndMakeVisible(pregainDial);
@@ -27,6 +27,12 @@ CompressorImplementationAudioProcessorEditor::CompressorImplementationAudioProce
     addAndMakeVisible(preDelayDial);
     addAndMakeVisible(postgainDial);
     addAndMakeVisible(wetDial);
+    addAndMakeVisible(zeroLatencyButton);
+    addAndMakeVisible(linkBox);
+    addAndMakeVisible(bandsBox);
+    addAndMakeVisible(oversamplingBox);
+    addAndMakeVisible(detectorBox);
+    addAndMakeVisible(meterLabel);
 
     addAndMakeVisible(pregainLabel);
     addAndMakeVisible(threshLabel);
@@ -100,15 +106,18 @@ CompressorImplementationAudioProcessorEditor::CompressorImplementationAudioProce
     postgainDial.setRange(-60.0f, 10.0f, 0.01);
     wetDial.setRange(0.0f, 1.0f, 0.001);
 
-    pregainDial.setValue(0.0f);
-    threshDial.setValue(-12.0f);
-    kneeDial.setValue(30.0f);
-    ratioDial.setValue(12.0f);
-    attackDial.setValue(0.003f);
-    releaseDial.setValue(0.250f);
-    preDelayDial.setValue(0.006f);
-    postgainDial.setValue(0.0f);
-    wetDial.setValue(1.0f);
+    // the controls start from the processor, which may have been restored from a saved state or
+    // changed while the editor was closed. the listeners are not attached yet, so nothing is sent back
+    const CompressorImplementationAudioProcessor::Settings& settings = audioProcessor.getSettings();
+    pregainDial.setValue(audioProcessor.getParameterValue(Compressor::pregainparam));
+    threshDial.setValue(audioProcessor.getParameterValue(Compressor::thresholdparam));
+    kneeDial.setValue(audioProcessor.getParameterValue(Compressor::kneeparam));
+    ratioDial.setValue(audioProcessor.getParameterValue(Compressor::ratioparam));
+    attackDial.setValue(audioProcessor.getParameterValue(Compressor::attackparam));
+    releaseDial.setValue(audioProcessor.getParameterValue(Compressor::releaseparam));
+    preDelayDial.setValue(settings.preDelay);
+    postgainDial.setValue(audioProcessor.getParameterValue(Compressor::postgainparam));
+    wetDial.setValue(audioProcessor.getParameterValue(Compressor::wetparam));
 
     pregainDial.setSkewFactorFromMidPoint(0.0);
     postgainDial.setSkewFactorFromMidPoint(0.0);
@@ -126,10 +135,65 @@ CompressorImplementationAudioProcessorEditor::CompressorImplementationAudioProce
     preDelayDial.addListener(this);
     postgainDial.addListener(this);
     wetDial.addListener(this);
+
+    // toggle settings, zero latency bypasses the pre delay for live monitoring
+    zeroLatencyButton.setButtonText("zero latency");
+    zeroLatencyButton.setToggleState(settings.zeroLatency, juce::dontSendNotification);
+    zeroLatencyButton.onClick = [this] { audioProcessor.updateZeroLatency(zeroLatencyButton.getToggleState()); };
+
+    // channel linking, the item ids are the Compressor::LinkMode values plus one
+    linkBox.addItem("link peak", Compressor::maxlink + 1);
+    linkBox.addItem("link mean", Compressor::meanlink + 1);
+    linkBox.addItem("link rms", Compressor::rmslink + 1);
+    linkBox.addItem("unlinked", Compressor::independentlink + 1);
+    linkBox.setSelectedId(settings.link + 1, juce::dontSendNotification);
+    linkBox.onChange = [this] { audioProcessor.updateLink(linkBox.getSelectedId() - 1); };
+
+    // multiband mode, the item ids are the band counts
+    bandsBox.addItem("1 band", 1);
+    for (int bands = 2; bands <= SF_MULTIBAND_MAXBANDS; bands++)
+        bandsBox.addItem(juce::String(bands) + " bands", bands);
+    bandsBox.setSelectedId(settings.bands, juce::dontSendNotification);
+    bandsBox.onChange = [this] { audioProcessor.updateBands(bandsBox.getSelectedId()); };
+
+    // oversampling, ids 2 to 4 run the whole engine at 2x, 4x and 8x, 5 to 7 only the detectors
+    oversamplingBox.addItem("no oversampling", 1);
+    for (int i = 0; i < 3; i++)
+        oversamplingBox.addItem(juce::String(2 << i) + "x oversampling", 2 + i);
+    for (int i = 0; i < 3; i++)
+        oversamplingBox.addItem(juce::String(2 << i) + "x detector", 5 + i);
+    int factorIndex = settings.oversampling == 8 ? 2 : settings.oversampling == 4 ? 1 : 0;
+    oversamplingBox.setSelectedId(settings.oversampling == 1 ? 1 : (settings.detectorOversampling ? 5 : 2) + factorIndex,
+        juce::dontSendNotification);
+    oversamplingBox.onChange = [this]
+    {
+        int id = oversamplingBox.getSelectedId();
+        audioProcessor.updateOversampling(id == 1 ? 1 : 2 << ((id - 2) % 3), id >= 5);
+    };
+
+    // level detection, the item ids are the RMS windows in ms and 1 for the peak
+    detectorBox.addItem("peak detector", 1);
+    for (int ms : { 5, 10, 20, 50, 100, 200, 300, 500 })
+        detectorBox.addItem("RMS " + juce::String(ms) + " ms", ms);
+    detectorBox.setSelectedId(settings.rmsWindow > 0.0f ? juce::roundToInt(settings.rmsWindow * 1000.0f) : 1,
+        juce::dontSendNotification);
+    detectorBox.onChange = [this]
+    {
+        int id = detectorBox.getSelectedId();
+        audioProcessor.updateRmsWindow(id == 1 ? 0.0f : id * 0.001f);
+    };
+
+    // meter settings, the processor only meters while the editor is open
+    meterLabel.setJustificationType(juce::Justification::centred);
+    audioProcessor.setMeterConsumer(true);
+    startTimerHz(30);
 }
 
 CompressorImplementationAudioProcessorEditor::~CompressorImplementationAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.setMeterConsumer(false);
+
     pregainDial.removeListener(this);
     threshDial.removeListener(this);
     kneeDial.removeListener(this);
@@ -161,6 +225,12 @@ void CompressorImplementationAudioProcessorEditor::resized()
     threshDial.setBounds(widthSection * 1 + aOffset, heightSection * 0 + aOffset + hOffset, dialWidth, dialWidth);
     postgainDial.setBounds(widthSection * 2 + aOffset, heightSection * 0 + aOffset + hOffset, dialWidth, dialWidth);
     wetDial.setBounds(widthSection * 4 + aOffset, heightSection * 0 + aOffset + hOffset, dialWidth, dialWidth);
+    zeroLatencyButton.setBounds(widthSection * 3 + aOffset, heightSection * 0 + aOffset + hOffset, dialWidth, 25);
+    meterLabel.setBounds(widthSection * 3 + aOffset, heightSection * 0 + aOffset + hOffset + 35, dialWidth, 40);
+    linkBox.setBounds(widthSection * 3 + aOffset, heightSection * 0 + aOffset + hOffset + 80, dialWidth, 25);
+    bandsBox.setBounds(widthSection * 3 + aOffset, heightSection * 0 + aOffset + hOffset + 110, dialWidth, 25);
+    oversamplingBox.setBounds(widthSection * 3 + aOffset, heightSection * 0 + aOffset + hOffset + 140, dialWidth, 25);
+    detectorBox.setBounds(widthSection * 4 + aOffset, heightSection * 0 + aOffset + hOffset + 110, dialWidth, 25);
 
     ratioDial.setBounds(widthSection * 0 + aOffset, heightSection * 1 + aOffset + hOffset, dialWidth, dialWidth);
     kneeDial.setBounds(widthSection * 1 + aOffset, heightSection * 1 + aOffset + hOffset, dialWidth, dialWidth);
@@ -169,6 +239,22 @@ void CompressorImplementationAudioProcessorEditor::resized()
     preDelayDial.setBounds(widthSection * 4 + aOffset, heightSection * 1 + aOffset + hOffset, dialWidth, dialWidth);
 }
 
+void CompressorImplementationAudioProcessorEditor::timerCallback()
+{
+    // peaks jump to the worst reading since the last tick and fall back slowly
+    float gainreduction = meterGainReduction * 0.8f;
+    float outputpeak = meterOutputPeak * 0.8f;
+    Compressor::MeterReading reading;
+    while (audioProcessor.popMeterReading(reading)) {
+        gainreduction = juce::jmin(gainreduction, reading.gainreduction);
+        outputpeak = juce::jmax(outputpeak, reading.outputpeak);
+    }
+    meterGainReduction = gainreduction;
+    meterOutputPeak = outputpeak;
+    meterLabel.setText("gr " + juce::String(meterGainReduction, 1) + " dB\nout "
+        + juce::String(juce::Decibels::gainToDecibels(meterOutputPeak), 1) + " dB", juce::dontSendNotification);
+}
+
 void CompressorImplementationAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
 {
     if (slider == &pregainDial) {
@@ -13,7 +13,8 @@
 //==============================================================================
 /**
 */
-class CompressorImplementationAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Slider::Listener
+class CompressorImplementationAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Slider::Listener,
+                                                      private juce::Timer
 {
 public:
     CompressorImplementationAudioProcessorEditor (CompressorImplementationAudioProcessor&);
@@ -24,6 +25,10 @@ public:
     void resized() override;
     void sliderValueChanged(juce::Slider* slider) override;
 
+private:
+    // drains the meter readings of the processor and updates the meter label
+    void timerCallback() override;
+
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -40,6 +45,18 @@ private:
     juce::Slider postgainDial;
     juce::Slider wetDial;
     const int dialWidth = 100;
+
+    // Toggles
+    juce::ToggleButton zeroLatencyButton;
+    juce::ComboBox linkBox;
+    juce::ComboBox bandsBox;
+    juce::ComboBox oversamplingBox;
+    juce::ComboBox detectorBox;
+
+    // Meter
+    juce::Label meterLabel;
+    float meterGainReduction = 0.0f; // dB, held with a slow release
+    float meterOutputPeak = 0.0f;
     
     // Labels
     juce::Label pregainLabel;
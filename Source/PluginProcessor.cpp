@@ -16,12 +16,29 @@ CompressorImplementationAudioProcessor::CompressorImplementationAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 #endif
 {
+    // the defaults match the ones the compressor and the editor dials start with
+    parameters[Compressor::pregainparam] = new juce::AudioParameterFloat("pregain", "Pre Gain", -60.0f, 10.0f, 0.0f);
+    parameters[Compressor::thresholdparam] = new juce::AudioParameterFloat("threshold", "Threshold", -60.0f, 0.0f, -12.0f);
+    parameters[Compressor::kneeparam] = new juce::AudioParameterFloat("knee", "Knee", 0.0f, 60.0f, 30.0f);
+    parameters[Compressor::ratioparam] = new juce::AudioParameterFloat("ratio", "Ratio", 2.0f, 20.0f, 12.0f);
+    parameters[Compressor::attackparam] = new juce::AudioParameterFloat("attack", "Attack", 0.003f, 1.0f, 0.003f);
+    parameters[Compressor::releaseparam] = new juce::AudioParameterFloat("release", "Release", 0.05f, 3.0f, 0.250f);
+    parameters[Compressor::postgainparam] = new juce::AudioParameterFloat("postgain", "Post Gain", -60.0f, 10.0f, 0.0f);
+    parameters[Compressor::wetparam] = new juce::AudioParameterFloat("wet", "Wet Level", 0.0f, 1.0f, 1.0f);
+    for (int p = 0; p < Compressor::numparameters; p++)
+    {
+        addParameter(parameters[p]);
+        sentValues[p] = parameters[p]->get();
+    }
+    for (int i = 0; i < SF_MULTIBAND_MAXBANDS - 1; i++)
+        settings.crossovers[i] = multiband.getCrossover(i);
 }
 
 CompressorImplementationAudioProcessor::~CompressorImplementationAudioProcessor()
@@ -95,13 +112,39 @@ void CompressorImplementationAudioProcessor::prepareToPlay (double sampleRate, i
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    comp.setSampleRate(sampleRate);
+    hostSampleRate = sampleRate;
+    prepareEngine();
+    updateLatency();
+   #if SF_COMPRESSOR_LOADMONITOR
+    loadMonitor.prepare(sampleRate);
+   #endif
+}
+
+void CompressorImplementationAudioProcessor::prepareEngine()
+{
+    // the predelay ring covers the full range of the pre delay dial at the real sample rate
+    int numChannels = juce::jmax(getMainBusNumInputChannels(), getMainBusNumOutputChannels());
+    if (isUsingDoublePrecision())
+    {
+        multibandDouble.prepare((int)hostSampleRate, numChannels, SF_COMPRESSOR_MAXPREDELAY, engineOversampling);
+        applyParameters(multibandDouble);
+    }
+    else
+    {
+        multiband.prepare((int)hostSampleRate, numChannels, SF_COMPRESSOR_MAXPREDELAY, engineOversampling);
+        applyParameters(multiband);
+    }
 }
 
 void CompressorImplementationAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+   #if SF_COMPRESSOR_LOADMONITOR
+    // the standalone app prints the load statistics of the run when audio stops
+    if (wrapperType == wrapperType_Standalone)
+        juce::Logger::writeToLog ("processBlock load:\n" + loadMonitor.dump());
+   #endif
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -111,18 +154,20 @@ bool CompressorImplementationAudioProcessor::isBusesLayoutSupported (const Buses
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // any layout from mono up to SF_COMPRESSOR_MAXCHANNELS channels, surround and ambisonic
+    // stems included. the channels are linked as set by updateLink
+    int numChannels = layouts.getMainOutputChannelSet().size();
+    if (numChannels < 1 || numChannels > SF_COMPRESSOR_MAXCHANNELS)
         return false;
 
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // the sidechain is optional, a key of any width the detectors can take
+    if (layouts.inputBuses.size() > 1 && layouts.getNumChannels(true, 1) > SF_COMPRESSOR_MAXCHANNELS)
+        return false;
    #endif
 
     return true;
@@ -132,6 +177,25 @@ bool CompressorImplementationAudioProcessor::isBusesLayoutSupported (const Buses
 
 void CompressorImplementationAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    process(multiband, buffer);
+}
+
+void CompressorImplementationAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(multibandDouble, buffer);
+}
+
+bool CompressorImplementationAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename Sample>
+void CompressorImplementationAudioProcessor::process(BasicMultibandCompressor<Sample>& compressor, juce::AudioBuffer<Sample>& buffer)
+{
+   #if SF_COMPRESSOR_LOADMONITOR
+    juce::uint64 loadStart = LoadMonitor::begin();
+   #endif
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -148,7 +212,33 @@ void CompressorImplementationAudioProcessor::processBlock (juce::AudioBuffer<flo
     // This is the place where you'd normally do the guts of your plugin's
     // audio processing...
 
-    comp.processBuffer(buffer);
+    // host automation and the editor dials arrive as parameter values. JUCE passes one value per block
+    // without the offset of the change, with VST3 the last one the host sent for the block. so each new
+    // value is taken as the one at the end of the block and ramped to over the whole block: automation
+    // that moves at a steady rate then gives the same output for any block size
+    typename BasicCompressor<Sample>::ParameterEvent events[Compressor::numparameters];
+    int numEvents = 0;
+    for (int p = 0; p < Compressor::numparameters; p++)
+    {
+        float value = parameters[p]->get();
+        if (value != sentValues[p])
+        {
+            events[numEvents++] = { 0, p, value, buffer.getNumSamples() };
+            sentValues[p] = value;
+        }
+    }
+    // the main bus is compressed in place. an enabled sidechain bus keys the detectors instead of it,
+    // a disabled one has no channels and leaves them on the main input
+    auto mainBuffer = getBusBuffer(buffer, true, 0);
+    juce::AudioBuffer<Sample> sidechainBuffer = getBusCount(true) > 1 ? getBusBuffer(buffer, true, 1)
+        : juce::AudioBuffer<Sample>();
+    compressor.processSidechain(mainBuffer.getArrayOfReadPointers(), mainBuffer.getArrayOfWritePointers(),
+        mainBuffer.getNumChannels(), mainBuffer.getNumSamples(), sidechainBuffer.getArrayOfReadPointers(),
+        sidechainBuffer.getNumChannels(), events, numEvents);
+
+   #if SF_COMPRESSOR_LOADMONITOR
+    loadMonitor.end(loadStart, buffer.getNumSamples());
+   #endif
 }
 
 //==============================================================================
@@ -165,15 +255,47 @@ juce::AudioProcessorEditor* CompressorImplementationAudioProcessor::createEditor
 //==============================================================================
 void CompressorImplementationAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // the automatable parameters by their ids, so a later version can add some and still load this.
+    // the other settings under names of their own
+    juce::XmlElement state ("CompressorState");
+    for (int p = 0; p < Compressor::numparameters; p++)
+        state.setAttribute (parameters[p]->paramID, (double) parameters[p]->get());
+    state.setAttribute ("predelay", (double) settings.preDelay);
+    state.setAttribute ("zerolatency", settings.zeroLatency);
+    state.setAttribute ("link", settings.link);
+    state.setAttribute ("bands", settings.bands);
+    for (int i = 0; i < SF_MULTIBAND_MAXBANDS - 1; i++)
+        state.setAttribute ("crossover" + juce::String (i), (double) settings.crossovers[i]);
+    state.setAttribute ("oversampling", settings.oversampling);
+    state.setAttribute ("detectoroversampling", settings.detectorOversampling);
+    state.setAttribute ("rmswindow", (double) settings.rmsWindow);
+    copyXmlToBinary (state, destData);
 }
 
 void CompressorImplementationAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    std::unique_ptr<juce::XmlElement> state (getXmlFromBinary (data, sizeInBytes));
+    if (state == nullptr || !state->hasTagName ("CompressorState"))
+        return;
+    // set like host automation, so the values reach the compressor as events in the next block.
+    // parameters missing from the state keep their current values
+    for (int p = 0; p < Compressor::numparameters; p++)
+    {
+        if (state->hasAttribute (parameters[p]->paramID))
+            *parameters[p] = (float) state->getDoubleAttribute (parameters[p]->paramID);
+    }
+    // the other settings go through the update functions like the editor's changes, the missing ones
+    // and states of older versions keep the current values as well
+    Settings loaded = settings;
+    updatePreDelay (juce::jlimit (0.0f, SF_COMPRESSOR_MAXPREDELAY, (float) state->getDoubleAttribute ("predelay", loaded.preDelay)));
+    updateZeroLatency (state->getBoolAttribute ("zerolatency", loaded.zeroLatency));
+    updateLink (juce::jlimit ((int) Compressor::maxlink, (int) Compressor::independentlink, state->getIntAttribute ("link", loaded.link)));
+    updateBands (juce::jlimit (1, SF_MULTIBAND_MAXBANDS, state->getIntAttribute ("bands", loaded.bands)));
+    for (int i = 0; i < SF_MULTIBAND_MAXBANDS - 1; i++)
+        updateCrossover (i, (float) state->getDoubleAttribute ("crossover" + juce::String (i), loaded.crossovers[i]));
+    updateOversampling (state->getIntAttribute ("oversampling", loaded.oversampling),
+        state->getBoolAttribute ("detectoroversampling", loaded.detectorOversampling));
+    updateRmsWindow (juce::jlimit (0.0f, SF_COMPRESSOR_MAXRMSWINDOW, (float) state->getDoubleAttribute ("rmswindow", loaded.rmsWindow)));
 }
 
 //==============================================================================
@@ -184,37 +306,147 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 }
 
 void CompressorImplementationAudioProcessor::updatePregain(float v) {
-    comp.set_linearpregain(v);
+    setParameter(Compressor::pregainparam, v);
 }
 
 void CompressorImplementationAudioProcessor::updateThresh(float v) {
-    comp.set_linearthreshold(v);
+    setParameter(Compressor::thresholdparam, v);
 }
 
 void CompressorImplementationAudioProcessor::updatePostgain(float v) {
-    comp.set_postgain(v);
+    setParameter(Compressor::postgainparam, v);
 }
 
 void CompressorImplementationAudioProcessor::updateWet(float v) {
-    comp.set_wetlevel(v);
+    setParameter(Compressor::wetparam, v);
 }
 
 void CompressorImplementationAudioProcessor::updatePreDelay(float v) {
-    comp.set_delaybufsize(comp.getSampleRate(), v);
+    settings.preDelay = v;
+    forEachBand([v](auto& band) { band.set_delaybufsize(band.getSampleRate(), v); });
+    updateLatency();
 }
 
 void CompressorImplementationAudioProcessor::updateRatio(float v) {
-    comp.set_slope(1.0/v);
+    setParameter(Compressor::ratioparam, v);
 }
 
 void CompressorImplementationAudioProcessor::updateKnee(float v) {
-    comp.calculate_knee(v);
+    setParameter(Compressor::kneeparam, v);
 }
 
 void CompressorImplementationAudioProcessor::updateAttack(float v) {
-    comp.set_attack(comp.getSampleRate(), v);
+    setParameter(Compressor::attackparam, v);
 }
 
 void CompressorImplementationAudioProcessor::updateRelease(float v) {
-    comp.set_release(comp.getSampleRate(), v);
+    setParameter(Compressor::releaseparam, v);
+}
+
+void CompressorImplementationAudioProcessor::updateZeroLatency(bool enabled) {
+    settings.zeroLatency = enabled;
+    forEachBand([enabled](auto& band) { band.set_zerolatency(enabled); });
+    updateLatency();
+}
+
+void CompressorImplementationAudioProcessor::updateLink(int mode) {
+    settings.link = mode;
+    forEachBand([mode](auto& band) { band.set_link((decltype(band.getLink()))mode); });
+}
+
+void CompressorImplementationAudioProcessor::updateBands(int numBands) {
+    settings.bands = numBands;
+    multiband.set_bands(numBands);
+    multibandDouble.set_bands(numBands);
+}
+
+void CompressorImplementationAudioProcessor::updateCrossover(int index, float frequency) {
+    settings.crossovers[index] = frequency;
+    multiband.set_crossover(index, frequency);
+    multibandDouble.set_crossover(index, frequency);
+}
+
+void CompressorImplementationAudioProcessor::updateOversampling(int factor, bool detectorOnly) {
+    settings.oversampling = Oversampler::normalize(factor);
+    settings.detectorOversampling = detectorOnly;
+    int detectorFactor = detectorOnly ? factor : 1;
+    forEachBand([detectorFactor](auto& band) { band.set_detectoroversampling(detectorFactor); });
+    int newEngineOversampling = detectorOnly ? 1 : Oversampler::normalize(factor);
+    if (newEngineOversampling != engineOversampling)
+    {
+        engineOversampling = newEngineOversampling;
+        // preparing allocates for the new rate, so the audio thread has to stay out meanwhile. before
+        // the first prepareToPlay the factor just waits for it
+        if (hostSampleRate > 0.0)
+        {
+            suspendProcessing(true);
+            prepareEngine();
+            suspendProcessing(false);
+        }
+    }
+    updateLatency();
+}
+
+void CompressorImplementationAudioProcessor::updateRmsWindow(float seconds) {
+    settings.rmsWindow = seconds;
+    forEachBand([seconds](auto& band) { band.set_rmswindow(band.getSampleRate(), seconds); });
+}
+
+void CompressorImplementationAudioProcessor::setMeterConsumer(bool attached) {
+    multiband.set_metering(attached);
+    multibandDouble.set_metering(attached);
+}
+
+bool CompressorImplementationAudioProcessor::popMeterReading(Compressor::MeterReading& reading) {
+    if (isUsingDoublePrecision())
+    {
+        CompressorDouble::MeterReading doubleReading;
+        if (!multibandDouble.popMeterReading(doubleReading))
+            return false;
+        reading = { doubleReading.gainreduction, doubleReading.inputpeak, doubleReading.inputrms,
+            doubleReading.outputpeak, doubleReading.outputrms };
+        return true;
+    }
+    return multiband.popMeterReading(reading);
+}
+
+void CompressorImplementationAudioProcessor::setParameter(int parameter, float v) {
+    // skip the echo of a value the parameter already holds, e.g. while the editor is being built
+    if (parameters[parameter]->get() != v)
+        *parameters[parameter] = v;
+}
+
+template <typename Sample>
+void CompressorImplementationAudioProcessor::applyParameters(BasicMultibandCompressor<Sample>& compressor) {
+    // the engine that was idle missed the events of the other one, so it takes the current
+    // values without a glide. idle bands too, they may be switched on later
+    for (int b = 0; b < SF_MULTIBAND_MAXBANDS; b++)
+    {
+        BasicCompressor<Sample>& band = compressor.getBand(b);
+        int sr = band.getSampleRate();
+        band.set_linearpregain(parameters[Compressor::pregainparam]->get());
+        band.set_linearthreshold(parameters[Compressor::thresholdparam]->get());
+        band.set_slope(1.0f / parameters[Compressor::ratioparam]->get());
+        band.set_postgain(parameters[Compressor::postgainparam]->get());
+        band.calculate_knee(parameters[Compressor::kneeparam]->get());
+        band.set_attack(sr, parameters[Compressor::attackparam]->get());
+        band.set_release(sr, parameters[Compressor::releaseparam]->get());
+        band.set_wetlevel(parameters[Compressor::wetparam]->get());
+    }
+    for (int p = 0; p < Compressor::numparameters; p++)
+        sentValues[p] = parameters[p]->get();
+}
+
+void CompressorImplementationAudioProcessor::updateLatency() {
+    // the host is told the exact delay in samples after clamping, not the dial value
+    setLatencySamples(isUsingDoublePrecision() ? multibandDouble.getLatencySamples() : multiband.getLatencySamples());
+}
+
+template <typename Function>
+void CompressorImplementationAudioProcessor::forEachBand(Function function) {
+    for (int b = 0; b < SF_MULTIBAND_MAXBANDS; b++)
+    {
+        function(multiband.getBand(b));
+        function(multibandDouble.getBand(b));
+    }
 }
\ No newline at end of file
@@ -9,7 +9,8 @@
 #pragma once
 
 #include <juce_audio_processors/juce_audio_processors.h>
-#include "Compressor.h"
+#include "MultibandCompressor.h"
+#include "LoadMonitor.h"
 
 //==============================================================================
 /**
@@ -30,6 +31,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -64,9 +67,79 @@ public:
     void updateKnee(float v);
     void updateAttack(float v);
     void updateRelease(float v);
+    void updateZeroLatency(bool enabled);
+    // one of Compressor::LinkMode, how the channels share the detector
+    void updateLink(int mode);
+    // 1 for the plain compressor, up to SF_MULTIBAND_MAXBANDS for multiband mode
+    void updateBands(int numBands);
+    // frequency of the crossover between band index and index + 1, in Hz
+    void updateCrossover(int index, float frequency);
+    // 1, 2, 4 or 8. detectorOnly oversamples just the key path of every band, otherwise the whole
+    // engine runs oversampled, which re-prepares it and so suspends processing while it switches
+    void updateOversampling(int factor, bool detectorOnly);
+    // RMS detector window in seconds, 0 for the peak detector
+    void updateRmsWindow(float seconds);
+
+    // the settings that are not automatable parameters, as last set by the update functions above.
+    // they are saved with the state, and the editor starts from them
+    struct Settings
+    {
+        float preDelay = 0.006f;
+        bool zeroLatency = false;
+        int link = Compressor::maxlink;
+        int bands = 1;
+        float crossovers[SF_MULTIBAND_MAXBANDS - 1];
+        int oversampling = 1;
+        bool detectorOversampling = false;
+        float rmsWindow = 0.0f;
+    };
+    const Settings& getSettings() const { return settings; }
+    // the current value of an automatable parameter, indexed by Compressor::Parameter
+    float getParameterValue(int parameter) const { return parameters[parameter]->get(); }
+
+    // metering is only computed while a consumer such as the editor is attached
+    void setMeterConsumer(bool attached);
+    bool popMeterReading(Compressor::MeterReading& reading);
+
+   #if SF_COMPRESSOR_LOADMONITOR
+    // processBlock timing, readable from any thread
+    LoadMonitor& getLoadMonitor() { return loadMonitor; }
+   #endif
 
 private:
-    Compressor comp;
+    // prepares the engine of the current precision at the host rate and oversampling
+    void prepareEngine();
+    // reports the current predelay to the host for delay compensation
+    void updateLatency();
+    // sets one of the automatable parameters from the editor, the host sees it like automation
+    void setParameter(int parameter, float v);
+    // the shared body of both processBlock overloads
+    template <typename Sample>
+    void process(BasicMultibandCompressor<Sample>& compressor, juce::AudioBuffer<Sample>& buffer);
+    // applies the automatable parameters to every band directly, before processing starts
+    template <typename Sample>
+    void applyParameters(BasicMultibandCompressor<Sample>& compressor);
+    // calls function with every band compressor of both precisions, in use or not
+    template <typename Function>
+    void forEachBand(Function function);
+
+    // one multiband engine per precision, the host picks one before prepareToPlay. with a single band
+    // it is the plain compressor. every band gets the same settings, the ones that are not parameters
+    // go to both precisions
+    MultibandCompressor multiband;
+    MultibandCompressorDouble multibandDouble;
+    // host automatable versions of the smoothed controls, indexed by Compressor::Parameter. their
+    // changes reach the compressor as parameter events, so they glide instead of jumping
+    juce::AudioParameterFloat* parameters[Compressor::numparameters];
+    // the values last sent to the compressor, audio thread only
+    float sentValues[Compressor::numparameters];
+    Settings settings;
+    // the rate of the last prepareToPlay, 0 before the first, and the oversampling of the whole engine
+    double hostSampleRate = 0.0;
+    int engineOversampling = 1;
+   #if SF_COMPRESSOR_LOADMONITOR
+    LoadMonitor loadMonitor;
+   #endif
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompressorImplementationAudioProcessor)
 };
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    SpscFifo.h
+    Created: 17 Oct 2026 8:41:05pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+// wait-free queue from one writer thread to one reader thread. unlike TripleBuffer every value is
+// delivered in order, as long as the reader keeps up; once Capacity values are waiting, push drops
+// the new value instead of blocking. Capacity must be a power of two
+template <typename T, int Capacity>
+class SpscFifo
+{
+
+public:
+
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscFifo capacity must be a power of two");
+
+    // writer side, returns false when the value was dropped because the fifo is full
+    bool push(const T& value)
+    {
+        unsigned int w = writepos.load(std::memory_order_relaxed);
+        if (w - readpos.load(std::memory_order_acquire) == (unsigned int)Capacity)
+        {
+            return false;
+        }
+        slots[w & indexmask] = value;
+        writepos.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    // reader side, returns false when there is nothing waiting
+    bool pop(T& value)
+    {
+        unsigned int r = readpos.load(std::memory_order_relaxed);
+        if (r == writepos.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = slots[r & indexmask];
+        readpos.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+
+    static constexpr unsigned int indexmask = Capacity - 1;
+
+    T slots[(size_t)Capacity];
+    // on separate cache lines, so the two threads do not invalidate each other's position
+    alignas(64) std::atomic<unsigned int> writepos { 0 };
+    alignas(64) std::atomic<unsigned int> readpos { 0 };
+};
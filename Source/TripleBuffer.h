@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+    Created: 17 Oct 2026 7:02:31pm
+    Author:  marks
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+// wait-free handoff of a value from one writer thread to one reader thread. the writer fills the
+// back slot and publishes it, the reader picks up the newest published slot at its own pace. neither
+// side ever blocks or allocates, and the reader always sees a complete value, never a half-written one
+template <typename T>
+class TripleBuffer
+{
+
+public:
+
+    TripleBuffer() : middle(1) {}
+
+    // writer side, the returned slot is owned by the writer until publish()
+    T& getWriteBuffer() { return slots[back]; }
+    void publish()
+    {
+        back = middle.exchange(back | dirtybit, std::memory_order_acq_rel) & indexmask;
+    }
+
+    // reader side, returns true when a newer value was picked up. the previous read slot is handed
+    // back to the writer right away, so references into it must not be used after this call
+    bool acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & dirtybit) == 0)
+        {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & indexmask;
+        return true;
+    }
+    const T& getReadBuffer() const { return slots[front]; }
+
+private:
+
+    static constexpr int dirtybit = 4;
+    static constexpr int indexmask = 3;
+
+    T slots[3];
+    int back = 0; // only touched by the writer
+    int front = 2; // only touched by the reader
+    std::atomic<int> middle;
+};
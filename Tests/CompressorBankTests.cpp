@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    CompressorBankTests.cpp
+    Created: 17 Oct 2026 11:48:20pm
+    Author:  marks
+
+    Unit tests for the lane-parallel CompressorBank.
+
+  ==============================================================================
+*/
+
+#include "../Source/CompressorBank.h"
+#include <juce_core/juce_core.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+class CompressorBankTest : public juce::UnitTest
+{
+public:
+
+    CompressorBankTest() : juce::UnitTest("Bank against Compressor", "CompressorBank") {}
+
+    void runTest() override
+    {
+        beginTest("4 lanes");
+        expectSameOutput<4>();
+
+        beginTest("8 lanes");
+        expectSameOutput<8>();
+
+        beginTest("16 lanes");
+        expectSameOutput<16>();
+    }
+
+private:
+
+    static constexpr int samplerate = 48000;
+    // not a whole number of groups for any lane count, so the padding lanes run as well
+    static constexpr int numinstances = 11;
+
+    // settings that differ per instance and take every branch of the lanes: pregain, hard and soft
+    // knee, the curve table, wet/dry mix, predelay and zero latency
+    static void configure(Compressor& comp, int k)
+    {
+        comp.prepare(samplerate, 2);
+        comp.set_linearpregain(k % 3 == 0 ? 6.0f : 0.0f);
+        comp.set_linearthreshold(-12.0f - 3.0f * (float)k);
+        comp.set_slope(1.0f / (2.0f + (float)k));
+        comp.set_attack(samplerate, 0.001f + 0.002f * (float)k);
+        comp.set_release(samplerate, 0.05f + 0.05f * (float)k);
+        comp.set_wetlevel(k % 4 == 3 ? 0.6f : 1.0f);
+        comp.set_delaybufsize(samplerate, 0.001f * (float)k);
+        comp.set_zerolatency(k == 7);
+        comp.calculate_knee(k % 2 == 1 ? 2.0f * (float)k : 0.0f);
+        comp.set_fastmath(k % 5 == 1);
+        comp.reset();
+    }
+
+    // each instance gets the noise of the other tests at its own level and offset
+    static void makeInput(int k, int numsamples, std::vector<float>& left, std::vector<float>& right)
+    {
+        juce::Random random(1234 + k);
+        left.resize((size_t)numsamples);
+        right.resize((size_t)numsamples);
+        float level = 0.1f + 0.09f * (float)k;
+        for (int i = 0; i < numsamples; i++)
+        {
+            int pos = i + 4001 * k;
+            float envelope = 0.01f + 0.99f * std::pow(0.5f + 0.5f * std::sin(6.0f * (float)M_PI * (float)pos / (float)samplerate), 4.0f);
+            left[(size_t)i] = level * envelope * (2.0f * random.nextFloat() - 1.0f);
+            right[(size_t)i] = level * envelope * (2.0f * random.nextFloat() - 1.0f);
+        }
+    }
+
+    // the compressors run for a while on their own, then each is copied into a lane and both go on with
+    // the same input. every lane has to give the output of its compressor bit for bit
+    template <int Lanes>
+    void expectSameOutput()
+    {
+        const int warmup = 1000;
+        const int numsamples = samplerate * 2;
+        const int blocksize = 300;
+
+        std::vector<std::unique_ptr<Compressor>> comps;
+        std::vector<std::vector<float>> compL(numinstances), compR(numinstances);
+        for (int k = 0; k < numinstances; k++)
+        {
+            comps.push_back(std::make_unique<Compressor>());
+            configure(*comps.back(), k);
+            makeInput(k, numsamples, compL[(size_t)k], compR[(size_t)k]);
+            float* ptrs[2] = { compL[(size_t)k].data(), compR[(size_t)k].data() };
+            comps.back()->processBuffer(ptrs, ptrs, 2, warmup);
+        }
+        std::vector<std::vector<float>> bankL = compL, bankR = compR;
+
+        auto bank = std::make_unique<CompressorBank<Lanes>>(numinstances, samplerate);
+        for (int k = 0; k < numinstances; k++)
+        {
+            bank->setInstance(k, *comps[(size_t)k]);
+        }
+
+        std::vector<float*> lptrs((size_t)numinstances), rptrs((size_t)numinstances);
+        for (int pos = warmup; pos < numsamples; pos += blocksize)
+        {
+            int len = juce::jmin(blocksize, numsamples - pos);
+            for (int k = 0; k < numinstances; k++)
+            {
+                float* ptrs[2] = { compL[(size_t)k].data() + pos, compR[(size_t)k].data() + pos };
+                comps[(size_t)k]->processBuffer(ptrs, ptrs, 2, len);
+                lptrs[(size_t)k] = bankL[(size_t)k].data() + pos;
+                rptrs[(size_t)k] = bankR[(size_t)k].data() + pos;
+            }
+            bank->processBuffers(lptrs.data(), rptrs.data(), len);
+        }
+
+        for (int k = 0; k < numinstances; k++)
+        {
+            expect(bankL[(size_t)k] == compL[(size_t)k] && bankR[(size_t)k] == compR[(size_t)k],
+                "instance " + juce::String(k));
+        }
+    }
+};
+
+static CompressorBankTest compressorBankTest;
@@ -0,0 +1,681 @@
+/*
+  ==============================================================================
+
+    CompressorTests.cpp
+    Created: 17 Oct 2026 11:48:20pm
+    Author:  marks
+
+    Unit tests for the single band Compressor.
+
+  ==============================================================================
+*/
+
+#include "../Source/Compressor.h"
+#include <juce_core/juce_core.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+template <typename Sample>
+using Channels = std::vector<std::vector<Sample>>;
+
+// runs all of in through comp in blocks of blocksize samples
+template <typename Sample>
+static Channels<Sample> render(BasicCompressor<Sample>& comp, const Channels<Sample>& in, int blocksize)
+{
+    int numchannels = (int)in.size();
+    int numsamples = (int)in[0].size();
+    Channels<Sample> out(in.size(), std::vector<Sample>((size_t)numsamples));
+    std::vector<const Sample*> inptrs((size_t)numchannels);
+    std::vector<Sample*> outptrs((size_t)numchannels);
+    for (int pos = 0; pos < numsamples; pos += blocksize)
+    {
+        int len = juce::jmin(blocksize, numsamples - pos);
+        for (int ch = 0; ch < numchannels; ch++)
+        {
+            inptrs[(size_t)ch] = in[(size_t)ch].data() + pos;
+            outptrs[(size_t)ch] = out[(size_t)ch].data() + pos;
+        }
+        comp.processBuffer(inptrs.data(), outptrs.data(), numchannels, len);
+    }
+    return out;
+}
+
+// noise under an envelope that swings over 40 dB three times a second, so the compressor attacks
+// and releases all the time
+template <typename Sample>
+static Channels<Sample> testSignal(int numchannels, int numsamples, int samplerate)
+{
+    juce::Random random(1234);
+    Channels<Sample> signal((size_t)numchannels, std::vector<Sample>((size_t)numsamples));
+    for (int i = 0; i < numsamples; i++)
+    {
+        float envelope = 0.01f + 0.99f * std::pow(0.5f + 0.5f * std::sin(6.0f * (float)M_PI * (float)i / (float)samplerate), 4.0f);
+        for (int ch = 0; ch < numchannels; ch++)
+        {
+            signal[(size_t)ch][(size_t)i] = (Sample)(envelope * (2.0f * random.nextFloat() - 1.0f));
+        }
+    }
+    return signal;
+}
+
+class PredelayTest : public juce::UnitTest
+{
+public:
+
+    PredelayTest() : juce::UnitTest("Predelay", "Compressor") {}
+
+    void runTest() override
+    {
+        beginTest("An impulse comes out the predelay later");
+        for (int samplerate : { 44100, 48000, 96000 })
+        {
+            for (float predelay : { 0.0f, 0.001f, 0.006f, 0.0213f, SF_COMPRESSOR_MAXPREDELAY })
+            {
+                int expected = (int)lroundf((float)samplerate * predelay);
+                auto comp = unityCompressor(samplerate);
+                comp->set_delaybufsize(samplerate, predelay);
+                comp->reset();
+                expectEquals(comp->getLatencySamples(), expected, "reported latency");
+                expectEquals(impulseDelay(*comp, samplerate, expected), expected, "delay of the output");
+            }
+        }
+
+        beginTest("Zero latency mode has no delay");
+        auto comp = unityCompressor(48000);
+        comp->set_delaybufsize(48000, 0.006f);
+        comp->set_zerolatency(true);
+        comp->reset();
+        expectEquals(comp->getLatencySamples(), 0, "reported latency");
+        expectEquals(impulseDelay(*comp, 48000, 0), 0, "delay of the output");
+    }
+
+private:
+
+    // nothing reaches the threshold of 0 dB without a knee
+    static std::unique_ptr<Compressor> unityCompressor(int samplerate)
+    {
+        auto comp = std::make_unique<Compressor>();
+        comp->prepare(samplerate, 2);
+        comp->set_linearthreshold(0.0f);
+        comp->calculate_knee(0.0f);
+        return comp;
+    }
+
+    // where an impulse below the threshold shows up, relative to where it went in. the envelope
+    // starts out reducing and has released to unity after a few seconds of silence, from then on the
+    // impulse has to come out unchanged
+    int impulseDelay(Compressor& comp, int samplerate, int predelay)
+    {
+        const int position = 3 * samplerate + 1;
+        Channels<float> in(2, std::vector<float>((size_t)(position + predelay + 1000)));
+        in[0][(size_t)position] = 0.01f;
+        in[1][(size_t)position] = -0.01f;
+        Channels<float> out = render(comp, in, 256);
+        int peak = 0;
+        for (int i = 0; i < (int)out[0].size(); i++)
+        {
+            if (std::abs(out[0][(size_t)i]) > std::abs(out[0][(size_t)peak]))
+                peak = i;
+        }
+        expectWithinAbsoluteError(out[0][(size_t)peak], 0.01f, 1e-6f, "left impulse");
+        expectWithinAbsoluteError(out[1][(size_t)peak], -0.01f, 1e-6f, "right impulse");
+        return peak - position;
+    }
+};
+
+static PredelayTest predelayTest;
+
+class BufferSizeTest : public juce::UnitTest
+{
+public:
+
+    BufferSizeTest() : juce::UnitTest("Buffer size invariance", "Compressor") {}
+
+    void runTest() override
+    {
+        const int samplerate = 48000;
+        Channels<float> in = testSignal<float>(2, samplerate * 2, samplerate);
+
+        beginTest("Peak detector");
+        expectSameOutput(in, [](Compressor&) {});
+
+        beginTest("Eco mode");
+        expectSameOutput(in, [](Compressor& comp) { comp.set_decimation(4); });
+
+        beginTest("RMS detector");
+        expectSameOutput(in, [=](Compressor& comp) { comp.set_rmswindow(samplerate, 0.05f); });
+
+        beginTest("Oversampled detector");
+        expectSameOutput(in, [=](Compressor& comp) { comp.set_detectoroversampling(4); });
+    }
+
+private:
+
+    // the chunk phase runs on across buffers, so every block size has to give the output of one
+    // call for the whole signal, bit for bit
+    template <typename Configure>
+    void expectSameOutput(const Channels<float>& in, Configure configure)
+    {
+        const int samplerate = 48000;
+        Channels<float> reference;
+        for (int blocksize : { (int)in[0].size(), 1, 37, 512, 4096 })
+        {
+            auto comp = std::make_unique<Compressor>();
+            comp->prepare(samplerate, 2);
+            comp->set_linearthreshold(-30.0f);
+            configure(*comp);
+            comp->reset();
+            Channels<float> out = render(*comp, in, blocksize);
+            if (reference.empty())
+            {
+                reference = out;
+                continue;
+            }
+            expect(out == reference, "block size " + juce::String(blocksize));
+        }
+    }
+};
+
+static BufferSizeTest bufferSizeTest;
+
+class PrecisionTest : public juce::UnitTest
+{
+public:
+
+    PrecisionTest() : juce::UnitTest("Float and double agreement", "Compressor") {}
+
+    void runTest() override
+    {
+        const int samplerate = 48000;
+        Channels<float> in = testSignal<float>(2, samplerate * 2, samplerate);
+        Channels<double> indouble(in.size());
+        for (size_t ch = 0; ch < in.size(); ch++)
+        {
+            indouble[ch].assign(in[ch].begin(), in[ch].end());
+        }
+
+        // the coefficients are float in both, so the paths only part by the rounding of the audio and
+        // the envelope. where the signal jumps and the gain moves fast that shows up to about -82 dB,
+        // otherwise it stays around -100 dB
+        for (float knee : { 0.0f, 6.0f })
+        {
+            beginTest("Knee " + juce::String(knee, 0) + " dB");
+            auto single = std::make_unique<Compressor>();
+            auto precise = std::make_unique<CompressorDouble>();
+            configure(*single, samplerate, knee);
+            configure(*precise, samplerate, knee);
+            Channels<float> out = render(*single, in, 512);
+            Channels<double> outdouble = render(*precise, indouble, 512);
+            double maxdiff = 0.0, sumsquares = 0.0;
+            size_t count = 0;
+            for (size_t ch = 0; ch < out.size(); ch++)
+            {
+                for (size_t i = 0; i < out[ch].size(); i++)
+                {
+                    double diff = std::abs((double)out[ch][i] - outdouble[ch][i]);
+                    maxdiff = juce::jmax(maxdiff, diff);
+                    sumsquares += diff * diff;
+                    count++;
+                }
+            }
+            double rmsdiff = std::sqrt(sumsquares / (double)count);
+            expectLessThan(juce::Decibels::gainToDecibels(maxdiff, -200.0), -75.0, "largest difference in dB");
+            expectLessThan(juce::Decibels::gainToDecibels(rmsdiff, -200.0), -95.0, "RMS of the difference in dB");
+        }
+    }
+
+private:
+
+    template <typename Sample>
+    static void configure(BasicCompressor<Sample>& comp, int samplerate, float knee)
+    {
+        comp.prepare(samplerate, 2);
+        comp.set_linearthreshold(-24.0f);
+        comp.set_slope(1.0f / 12.0f);
+        comp.calculate_knee(knee);
+        comp.reset();
+    }
+};
+
+static PrecisionTest precisionTest;
+
+class RmsDriftTest : public juce::UnitTest
+{
+public:
+
+    RmsDriftTest() : juce::UnitTest("RMS drift", "Compressor") {}
+
+    void runTest() override
+    {
+        beginTest("The window sum forgets a long loud passage");
+        const int samplerate = 48000;
+        auto comp = std::make_unique<Compressor>();
+        comp->prepare(samplerate, 2);
+        comp->set_rmswindow(samplerate, 0.05f);
+        comp->reset();
+        int window = comp->getRmsWindowSamples();
+
+        // five minutes of full scale noise, then a quiet passage of several windows at a steady
+        // level. every square of the noise has been added to the running sum and subtracted again,
+        // and the rounding of that must not be left in the sum of the quiet window
+        const int blocksize = 4096;
+        Channels<float> loud = testSignal<float>(2, blocksize * 32, samplerate);
+        std::vector<const float*> inptrs(2);
+        std::vector<float> scratchL((size_t)blocksize), scratchR((size_t)blocksize);
+        float* outptrs[2] = { scratchL.data(), scratchR.data() };
+        int numblocks = 5 * 60 * samplerate / blocksize;
+        for (int b = 0; b < numblocks; b++)
+        {
+            int offset = (b % 32) * blocksize;
+            inptrs[0] = loud[0].data() + offset;
+            inptrs[1] = loud[1].data() + offset;
+            comp->processBuffer(inptrs.data(), outptrs, 2, blocksize);
+        }
+        const float quiet = 0.001f;
+        std::vector<float> steady((size_t)blocksize, quiet);
+        inptrs[0] = steady.data();
+        inptrs[1] = steady.data();
+        for (int pos = 0; pos < 4 * window; pos += blocksize)
+        {
+            comp->processBuffer(inptrs.data(), outptrs, 2, blocksize);
+        }
+
+        Compressor::EnvelopeState state = comp->getEnvelopeState();
+        double mean = (double)state.detectors[0].rmssum / window;
+        expectWithinAbsoluteError(mean, (double)quiet * quiet, 1e-3 * quiet * quiet, "mean square of the quiet window");
+    }
+};
+
+static RmsDriftTest rmsDriftTest;
+
+class CurveTableTest : public juce::UnitTest
+{
+public:
+
+    CurveTableTest() : juce::UnitTest("Fast math curve table", "Compressor") {}
+
+    void runTest() override
+    {
+        // the bounds documented at SF_COMPRESSOR_CURVESTEPBITS. a knee under 1 dB is as sharp as a hard
+        // one at the resolution of the table
+        beginTest("Table against the exact curve");
+        auto comp = std::make_unique<Compressor>();
+        comp->prepare(48000, 2);
+        double worsthard = 0.0, worstsoft = 0.0;
+        for (float threshold = -60.0f; threshold <= 0.0f; threshold += 1.5f)
+        {
+            for (float knee : { 0.0f, 0.1f, 0.5f, 1.0f, 3.0f, 6.0f, 12.0f, 24.0f, 60.0f })
+            {
+                for (float ratio : { 2.0f, 4.0f, 8.0f, 20.0f })
+                {
+                    double error = worstError(*comp, threshold, knee, ratio);
+                    double& worst = knee < 1.0f ? worsthard : worstsoft;
+                    worst = juce::jmax(worst, error);
+                }
+            }
+        }
+        expectLessThan(worsthard, 0.032, "hard knee error in dB");
+        expectLessThan(worstsoft, 0.017, "soft knee error in dB");
+    }
+
+private:
+
+    // the largest difference in dB over the table range, two levels per table step, and densely
+    // around the threshold and the end of the knee where the curve bends
+    static double worstError(Compressor& comp, float threshold, float knee, float ratio)
+    {
+        const int coarse = SF_COMPRESSOR_CURVEOCTAVES << (SF_COMPRESSOR_CURVESTEPBITS + 1);
+        const int fine = 64;
+        std::vector<float> levels;
+        for (int i = 0; i < coarse; i++)
+        {
+            levels.push_back(std::exp2((float)SF_COMPRESSOR_CURVEMINEXP + (float)SF_COMPRESSOR_CURVEOCTAVES * ((float)i + 0.5f) / (float)coarse));
+        }
+        for (float corner : { threshold, threshold + knee })
+        {
+            for (int i = 0; i < fine; i++)
+            {
+                levels.push_back(juce::Decibels::decibelsToGain(corner - 0.2f + 0.4f * (float)i / (float)(fine - 1)));
+            }
+        }
+
+        comp.set_fastmath(false);
+        comp.set_linearthreshold(threshold);
+        comp.set_slope(1.0f / ratio);
+        comp.calculate_knee(knee);
+        std::vector<float> exact;
+        for (float x : levels)
+        {
+            exact.push_back(comp.getCurveAttenuation(x));
+        }
+        comp.set_fastmath(true);
+        double worst = 0.0;
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            double ratiodb = 20.0 * std::log10((double)comp.getCurveAttenuation(levels[i]) / (double)exact[i]);
+            worst = juce::jmax(worst, std::abs(ratiodb));
+        }
+        return worst;
+    }
+};
+
+static CurveTableTest curveTableTest;
+
+class SplitGainTest : public juce::UnitTest
+{
+public:
+
+    SplitGainTest() : juce::UnitTest("Split gain processing", "Compressor") {}
+
+    void runTest() override
+    {
+        const int samplerate = 48000;
+        Channels<float> key = testSignal<float>(2, samplerate * 2, samplerate);
+        // two targets that have nothing to do with the key or each other
+        Channels<float> targets[2];
+        for (int t = 0; t < 2; t++)
+        {
+            juce::Random random(77 + t);
+            targets[t].assign(2, std::vector<float>(key[0].size()));
+            for (std::vector<float>& channel : targets[t])
+            {
+                for (float& s : channel)
+                {
+                    s = 0.5f * (2.0f * random.nextFloat() - 1.0f);
+                }
+            }
+        }
+
+        beginTest("Unity pregain");
+        expectSameOutput(key, targets, 0.0f, 0.0);
+
+        // the pregain is applied to the key by the gain stage of one and to the target by the other
+        beginTest("With pregain");
+        expectSameOutput(key, targets, 6.0f, 1e-6);
+    }
+
+private:
+
+    static void configure(Compressor& comp, int samplerate, float pregain)
+    {
+        comp.prepare(samplerate, 2);
+        comp.set_linearpregain(pregain);
+        comp.set_linearthreshold(-30.0f);
+        comp.set_slope(1.0f / 8.0f);
+        comp.calculate_knee(6.0f);
+        comp.set_postgain(3.0f);
+        comp.set_wetlevel(0.7f);
+        comp.set_zerolatency(true);
+        comp.reset();
+    }
+
+    // computeGain over the key once and applyGain to each target against processSidechain of each
+    // target, in blocks of 512 samples
+    void expectSameOutput(const Channels<float>& key, const Channels<float> (&targets)[2], float pregain,
+        double tolerance)
+    {
+        const int samplerate = 48000;
+        const int blocksize = 512;
+        int numsamples = (int)key[0].size();
+        auto split = std::make_unique<Compressor>();
+        configure(*split, samplerate, pregain);
+        std::vector<float> gain((size_t)numsamples);
+        Channels<float> applied[2] = { targets[0], targets[1] };
+        for (int pos = 0; pos < numsamples; pos += blocksize)
+        {
+            int len = juce::jmin(blocksize, numsamples - pos);
+            const float* keyptrs[2] = { key[0].data() + pos, key[1].data() + pos };
+            split->computeGain(keyptrs, 2, gain.data() + pos, len);
+        }
+        for (int t = 0; t < 2; t++)
+        {
+            float* ptrs[2] = { applied[t][0].data(), applied[t][1].data() };
+            Compressor::applyGain(gain.data(), ptrs, ptrs, 2, numsamples);
+
+            auto whole = std::make_unique<Compressor>();
+            configure(*whole, samplerate, pregain);
+            Channels<float> out = targets[t];
+            for (int pos = 0; pos < numsamples; pos += blocksize)
+            {
+                int len = juce::jmin(blocksize, numsamples - pos);
+                const float* keyptrs[2] = { key[0].data() + pos, key[1].data() + pos };
+                float* outptrs[2] = { out[0].data() + pos, out[1].data() + pos };
+                whole->processSidechain(outptrs, outptrs, 2, len, keyptrs, 2);
+            }
+            if (tolerance <= 0.0)
+            {
+                expect(applied[t] == out, "target " + juce::String(t) + " differs");
+                continue;
+            }
+            double maxdiff = 0.0;
+            for (size_t ch = 0; ch < out.size(); ch++)
+            {
+                for (size_t i = 0; i < out[ch].size(); i++)
+                {
+                    maxdiff = juce::jmax(maxdiff, std::abs((double)applied[t][ch][i] - (double)out[ch][i]));
+                }
+            }
+            expectLessThan(maxdiff, tolerance, "largest difference of target " + juce::String(t));
+        }
+    }
+};
+
+static SplitGainTest splitGainTest;
+
+class LinkModeTest : public juce::UnitTest
+{
+public:
+
+    LinkModeTest() : juce::UnitTest("Link modes", "Compressor") {}
+
+    void runTest() override
+    {
+        // with one of two channels silent the mean of the magnitudes is 6 dB below the peak and the RMS
+        // 3 dB, which a ratio of 8 turns into 7/8 of that less reduction
+        beginTest("Peak link");
+        double peak = ducking(Compressor::maxlink);
+        expectGreaterThan(peak, 6.0, "the quiet channel follows the loud one, in dB");
+        beginTest("Mean link");
+        expectWithinAbsoluteError(ducking(Compressor::meanlink), peak - 6.02 * 7.0 / 8.0, 1.0, "reduction in dB");
+        beginTest("RMS link");
+        expectWithinAbsoluteError(ducking(Compressor::rmslink), peak - 3.01 * 7.0 / 8.0, 1.0, "reduction in dB");
+        beginTest("Unlinked");
+        expectWithinAbsoluteError(ducking(Compressor::independentlink), 0.0, 0.01, "the quiet channel keeps its gain, in dB");
+    }
+
+private:
+
+    // the left channel is steady noise well above the threshold, the right one a sine far below the threshold. returns how much
+    // more the sine is reduced than with a silent left channel, over the last second
+    double ducking(Compressor::LinkMode mode)
+    {
+        const int samplerate = 48000;
+        const int numsamples = 4 * samplerate;
+        Channels<float> in(2, std::vector<float>((size_t)numsamples));
+        juce::Random random(1234);
+        for (int i = 0; i < numsamples; i++)
+        {
+            in[0][(size_t)i] = 0.5f * (2.0f * random.nextFloat() - 1.0f);
+            in[1][(size_t)i] = 0.001f * std::sin(2.0f * (float)M_PI * 440.0f * (float)i / (float)samplerate);
+        }
+        Channels<float> quiet = in;
+        std::fill(quiet[0].begin(), quiet[0].end(), 0.0f);
+
+        double levels[2];
+        for (int run = 0; run < 2; run++)
+        {
+            auto comp = std::make_unique<Compressor>();
+            comp->prepare(samplerate, 2);
+            comp->set_linearthreshold(-30.0f);
+            comp->set_slope(1.0f / 8.0f);
+            comp->calculate_knee(0.0f);
+            comp->set_link(mode);
+            comp->reset();
+            Channels<float> out = render(*comp, run == 0 ? in : quiet, 512);
+            double sum = 0.0;
+            for (int i = numsamples - samplerate; i < numsamples; i++)
+            {
+                sum += (double)out[1][(size_t)i] * (double)out[1][(size_t)i];
+            }
+            levels[run] = std::sqrt(sum / samplerate);
+        }
+        expectGreaterThan(levels[1], 0.0, "level of the sine");
+        return juce::Decibels::gainToDecibels(levels[1] / levels[0], -200.0);
+    }
+};
+
+static LinkModeTest linkModeTest;
+
+class PredelayFadeTest : public juce::UnitTest
+{
+public:
+
+    PredelayFadeTest() : juce::UnitTest("Predelay changes", "Compressor") {}
+
+    void runTest() override
+    {
+        beginTest("A new predelay crossfades without a click");
+        const int samplerate = 48000;
+        const int blocksize = 512;
+        const float amplitude = 0.01f;
+        const float frequency = 1000.0f;
+        auto comp = std::make_unique<Compressor>();
+        comp->prepare(samplerate, 1);
+        comp->set_linearthreshold(0.0f);
+        comp->calculate_knee(0.0f);
+        comp->set_delaybufsize(samplerate, 0.006f);
+        comp->reset();
+
+        // the envelope releases to unity over the first seconds, then the predelay changes every half
+        // second, between taps that are far apart in phase
+        const float predelays[] = { 0.0213f, 0.001f, 0.0f, SF_COMPRESSOR_MAXPREDELAY, 0.006f };
+        const int start = 3 * samplerate;
+        const int numsamples = start + 3 * samplerate;
+        std::vector<float> signal((size_t)numsamples);
+        for (int i = 0; i < numsamples; i++)
+        {
+            signal[(size_t)i] = amplitude * std::sin(2.0f * (float)M_PI * frequency * (float)i / (float)samplerate);
+        }
+        int next = 0;
+        for (int pos = 0; pos < numsamples; pos += blocksize)
+        {
+            if (pos >= start + next * samplerate / 2 && next < (int)(sizeof(predelays) / sizeof(predelays[0])))
+            {
+                comp->set_delaybufsize(samplerate, predelays[next++]);
+            }
+            float* channel = signal.data() + pos;
+            comp->processBuffer(&channel, &channel, 1, juce::jmin(blocksize, numsamples - pos));
+        }
+        expectEquals(next, 5, "predelay changes");
+
+        // each tap moves by at most the steepest step of the sine, and the crossfade between them adds
+        // at most their largest difference over the length of the fade
+        double steepest = amplitude * 2.0 * M_PI * frequency / samplerate;
+        double bound = steepest + 2.0 * amplitude / SF_COMPRESSOR_DELAYFADE;
+        double largest = 0.0;
+        for (int i = start + 1; i < numsamples; i++)
+        {
+            largest = juce::jmax(largest, (double)std::abs(signal[(size_t)i] - signal[(size_t)i - 1]));
+        }
+        expectLessThan(largest, bound * 1.001, "largest step from one sample to the next");
+    }
+};
+
+static PredelayFadeTest predelayFadeTest;
+
+class MeteringTest : public juce::UnitTest
+{
+public:
+
+    MeteringTest() : juce::UnitTest("Metering", "Compressor") {}
+
+    void runTest() override
+    {
+        const int samplerate = 48000;
+        const int numsamples = 2 * samplerate;
+        const float amplitude = 0.5f;
+        auto comp = std::make_unique<Compressor>();
+        comp->prepare(samplerate, 2);
+        comp->set_linearthreshold(-20.0f);
+        comp->set_slope(1.0f / 4.0f);
+        comp->calculate_knee(0.0f);
+        comp->set_metering(true);
+        comp->reset();
+
+        beginTest("One reading per period");
+        Channels<float> in(2, std::vector<float>((size_t)numsamples));
+        for (int i = 0; i < numsamples; i++)
+        {
+            in[0][(size_t)i] = amplitude * std::sin(2.0f * (float)M_PI * 1000.0f * (float)i / (float)samplerate);
+            in[1][(size_t)i] = -in[0][(size_t)i];
+        }
+        Channels<float> out = in;
+        std::vector<Compressor::MeterReading> readings = process(*comp, out);
+        expectEquals((int)readings.size(), numsamples / SF_COMPRESSOR_METERSAMPLES, "readings");
+        if (readings.empty())
+            return;
+
+        // a sine 6 dB below full scale, 14 dB over the threshold, comes out 10.5 dB down at a ratio of 4
+        beginTest("Levels and gain reduction");
+        const Compressor::MeterReading& last = readings.back();
+        expectWithinAbsoluteError(last.gainreduction, -10.5f, 0.5f, "gain reduction in dB");
+        size_t start = readings.size() * SF_COMPRESSOR_METERSAMPLES - SF_COMPRESSOR_METERSAMPLES;
+        float inputpeak, inputrms, outputpeak, outputrms;
+        levels(in, start, inputpeak, inputrms);
+        levels(out, start, outputpeak, outputrms);
+        expectWithinAbsoluteError(last.inputpeak, inputpeak, 1e-6f, "input peak");
+        expectWithinAbsoluteError(last.inputrms, inputrms, 1e-5f, "input RMS");
+        expectWithinAbsoluteError(last.outputpeak, outputpeak, 1e-6f, "output peak");
+        expectWithinAbsoluteError(last.outputrms, outputrms, 1e-5f, "output RMS");
+
+        // readings that were published before the switch stay in the queue, nothing follows them
+        beginTest("Nothing while metering is off");
+        comp->set_metering(false);
+        Compressor::MeterReading reading;
+        while (comp->popMeterReading(reading))
+        {
+        }
+        out = in;
+        expect(process(*comp, out).empty(), "readings after switching off");
+    }
+
+private:
+
+    // processes signal in place in blocks of 512, draining the readings after every block like a meter
+    // display would
+    static std::vector<Compressor::MeterReading> process(Compressor& comp, Channels<float>& signal)
+    {
+        std::vector<Compressor::MeterReading> readings;
+        int numsamples = (int)signal[0].size();
+        for (int pos = 0; pos < numsamples; pos += 512)
+        {
+            float* ptrs[2] = { signal[0].data() + pos, signal[1].data() + pos };
+            comp.processBuffer(ptrs, ptrs, 2, juce::jmin(512, numsamples - pos));
+            Compressor::MeterReading reading;
+            while (comp.popMeterReading(reading))
+            {
+                readings.push_back(reading);
+            }
+        }
+        return readings;
+    }
+
+    // peak and RMS across the channels of the metering period from start
+    static void levels(const Channels<float>& signal, size_t start, float& peak, float& rms)
+    {
+        double sum = 0.0;
+        peak = 0.0f;
+        for (const std::vector<float>& channel : signal)
+        {
+            for (size_t i = start; i < start + SF_COMPRESSOR_METERSAMPLES; i++)
+            {
+                peak = juce::jmax(peak, std::abs(channel[i]));
+                sum += (double)channel[i] * (double)channel[i];
+            }
+        }
+        rms = (float)std::sqrt(sum / (double)(signal.size() * SF_COMPRESSOR_METERSAMPLES));
+    }
+};
+
+static MeteringTest meteringTest;
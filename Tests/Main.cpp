@@ -0,0 +1,27 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 17 Oct 2026 11:48:20pm
+    Author:  marks
+
+    Runs every juce::UnitTest linked into CompressorTests and returns 1 when
+    any of them failed, so ctest can run the suite.
+
+  ==============================================================================
+*/
+
+#include <juce_core/juce_core.h>
+
+int main(int, char*[])
+{
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runAllTests();
+    int failures = 0;
+    for (int i = 0; i < runner.getNumResults(); i++)
+    {
+        failures += runner.getResult(i)->failures;
+    }
+    return failures > 0 ? 1 : 0;
+}
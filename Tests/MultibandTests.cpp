@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    MultibandTests.cpp
+    Created: 17 Oct 2026 11:48:20pm
+    Author:  marks
+
+    Unit tests for the multiband engine.
+
+  ==============================================================================
+*/
+
+#include "../Source/MultibandCompressor.h"
+#include <juce_core/juce_core.h>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <vector>
+
+class CrossoverTest : public juce::UnitTest
+{
+public:
+
+    CrossoverTest() : juce::UnitTest("Crossover flatness", "Multiband") {}
+
+    void runTest() override
+    {
+        for (int numbands = 2; numbands <= SF_MULTIBAND_MAXBANDS; numbands++)
+        {
+            beginTest(juce::String(numbands) + " bands");
+            expectFlat<float>(numbands, 0.01);
+            expectFlat<double>(numbands, 0.0001);
+        }
+    }
+
+private:
+
+    // the impulse response of the engine with every band at unity gain, from the impulse on
+    template <typename Sample>
+    static std::vector<Sample> impulseResponse(int numbands, int samplerate, int length)
+    {
+        const float frequencies[SF_MULTIBAND_MAXBANDS - 1] = { 120.0f, 500.0f, 2000.0f, 8000.0f };
+        auto engine = std::make_unique<BasicMultibandCompressor<Sample>>();
+        engine->prepare(samplerate, 1);
+        engine->set_bands(numbands);
+        for (int x = 0; x < numbands - 1; x++)
+        {
+            engine->set_crossover(x, frequencies[x]);
+        }
+        for (int b = 0; b < numbands; b++)
+        {
+            engine->getBand(b).set_linearthreshold(0.0f);
+            engine->getBand(b).calculate_knee(0.0f);
+        }
+        engine->reset();
+
+        // the envelopes start out reducing, the impulse waits until they have released to unity
+        const int position = 3 * samplerate;
+        const Sample height = (Sample)0.01f;
+        int latency = engine->getLatencySamples();
+        std::vector<Sample> signal((size_t)(position + latency + length));
+        signal[(size_t)position] = height;
+        Sample* channel = signal.data();
+        for (int pos = 0; pos < (int)signal.size(); pos += 512)
+        {
+            const Sample* input = channel + pos;
+            Sample* output = channel + pos;
+            engine->processBuffer(&input, &output, 1, juce::jmin(512, (int)signal.size() - pos));
+        }
+        std::vector<Sample> response(signal.begin() + position + latency, signal.end());
+        for (Sample& s : response)
+        {
+            s /= height;
+        }
+        return response;
+    }
+
+    // the bands all carry the phase of the crossover allpasses, so the magnitude of their sum is 1 at
+    // every frequency, up to the rounding of Sample
+    template <typename Sample>
+    void expectFlat(int numbands, double tolerancedb)
+    {
+        const int samplerate = 48000;
+        std::vector<Sample> response = impulseResponse<Sample>(numbands, samplerate, 16384);
+        double maxdeviation = 0.0;
+        for (double frequency = 20.0; frequency < 20000.0; frequency *= 1.1)
+        {
+            std::complex<double> sum = 0.0;
+            double w = -2.0 * M_PI * frequency / samplerate;
+            for (size_t i = 0; i < response.size(); i++)
+            {
+                sum += (double)response[i] * std::polar(1.0, w * (double)i);
+            }
+            maxdeviation = juce::jmax(maxdeviation, std::abs(20.0 * std::log10(std::abs(sum))));
+        }
+        expectLessThan(maxdeviation, tolerancedb, "largest deviation from flat in dB, " + juce::String((int)sizeof(Sample) * 8) + " bit");
+    }
+};
+
+static CrossoverTest crossoverTest;
+
+class MultibandMeteringTest : public juce::UnitTest
+{
+public:
+
+    MultibandMeteringTest() : juce::UnitTest("Multiband metering", "Multiband") {}
+
+    void runTest() override
+    {
+        typedef MultibandCompressor::Band::MeterReading MeterReading;
+        const int samplerate = 48000;
+        const int numsamples = 2 * samplerate;
+        auto engine = std::make_unique<MultibandCompressor>();
+        engine->prepare(samplerate, 1);
+        engine->set_bands(2);
+        engine->set_crossover(0, 200.0f);
+        for (int b = 0; b < 2; b++)
+        {
+            engine->getBand(b).set_linearthreshold(-20.0f);
+            engine->getBand(b).set_slope(1.0f / 4.0f);
+            engine->getBand(b).calculate_knee(0.0f);
+        }
+        engine->set_metering(true);
+        engine->reset();
+
+        // a sine in the upper band only, 14 dB over the threshold
+        beginTest("One reading per period");
+        std::vector<float> in((size_t)numsamples);
+        for (int i = 0; i < numsamples; i++)
+        {
+            in[(size_t)i] = 0.5f * std::sin(2.0f * (float)M_PI * 1000.0f * (float)i / (float)samplerate);
+        }
+        std::vector<float> out = in;
+        std::vector<MeterReading> readings;
+        for (int pos = 0; pos < numsamples; pos += 512)
+        {
+            float* channel = out.data() + pos;
+            engine->processBuffer(&channel, &channel, 1, juce::jmin(512, numsamples - pos));
+            MeterReading reading;
+            while (engine->popMeterReading(reading))
+            {
+                readings.push_back(reading);
+            }
+        }
+        expectEquals((int)readings.size(), numsamples / SF_COMPRESSOR_METERSAMPLES, "readings");
+        if (readings.empty())
+            return;
+
+        // the reduction of the band that compresses, the levels of the whole input and output
+        beginTest("Levels and gain reduction");
+        const MeterReading& last = readings.back();
+        expectWithinAbsoluteError(last.gainreduction, -10.5f, 0.5f, "gain reduction in dB");
+        size_t start = readings.size() * SF_COMPRESSOR_METERSAMPLES - SF_COMPRESSOR_METERSAMPLES;
+        float peak, rms;
+        levels(in, start, peak, rms);
+        expectWithinAbsoluteError(last.inputpeak, peak, 1e-6f, "input peak");
+        expectWithinAbsoluteError(last.inputrms, rms, 1e-5f, "input RMS");
+        levels(out, start, peak, rms);
+        expectWithinAbsoluteError(last.outputpeak, peak, 1e-6f, "output peak");
+        expectWithinAbsoluteError(last.outputrms, rms, 1e-5f, "output RMS");
+
+        beginTest("Nothing while metering is off");
+        engine->set_metering(false);
+        MeterReading reading;
+        while (engine->popMeterReading(reading))
+        {
+        }
+        out = in;
+        int after = 0;
+        for (int pos = 0; pos < numsamples; pos += 512)
+        {
+            float* channel = out.data() + pos;
+            engine->processBuffer(&channel, &channel, 1, juce::jmin(512, numsamples - pos));
+            while (engine->popMeterReading(reading))
+            {
+                after++;
+            }
+        }
+        expectEquals(after, 0, "readings after switching off");
+    }
+
+private:
+
+    static void levels(const std::vector<float>& signal, size_t start, float& peak, float& rms)
+    {
+        double sum = 0.0;
+        peak = 0.0f;
+        for (size_t i = start; i < start + SF_COMPRESSOR_METERSAMPLES; i++)
+        {
+            peak = juce::jmax(peak, std::abs(signal[i]));
+            sum += (double)signal[i] * (double)signal[i];
+        }
+        rms = (float)std::sqrt(sum / SF_COMPRESSOR_METERSAMPLES);
+    }
+};
+
+static MultibandMeteringTest multibandMeteringTest;
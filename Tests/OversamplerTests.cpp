@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    OversamplerTests.cpp
+    Created: 17 Oct 2026 11:48:20pm
+    Author:  marks
+
+    Unit tests for the half-band oversampler.
+
+  ==============================================================================
+*/
+
+#include "../Source/Oversampler.h"
+#include <juce_core/juce_core.h>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+class OversamplerTest : public juce::UnitTest
+{
+public:
+
+    OversamplerTest() : juce::UnitTest("Oversampler", "Oversampler") {}
+
+    void runTest() override
+    {
+        for (int factor : { 2, 4, 8 })
+        {
+            beginTest("Upsampling by " + juce::String(factor));
+            expectUpsampling(factor);
+            beginTest("Downsampling by " + juce::String(factor));
+            expectDownsampling(factor);
+        }
+    }
+
+private:
+
+    // analysed base rate samples, the sines sit on whole bins of this length so nothing leaks. the
+    // filters settle during the samples before
+    static constexpr int length = 4096;
+    static constexpr int settle = 1024;
+
+    // the amplitude of bin of the numsamples samples from start
+    static double amplitude(const std::vector<float>& signal, size_t start, int numsamples, int bin)
+    {
+        std::complex<double> sum = 0.0;
+        for (int i = 0; i < numsamples; i++)
+        {
+            sum += (double)signal[start + (size_t)i] * std::polar(1.0, -2.0 * M_PI * bin * i / numsamples);
+        }
+        return 2.0 * std::abs(sum) / numsamples;
+    }
+
+    static std::vector<float> sine(int numsamples, int bin, int period)
+    {
+        std::vector<float> signal((size_t)numsamples);
+        for (int i = 0; i < numsamples; i++)
+        {
+            signal[(size_t)i] = (float)std::sin(2.0 * M_PI * bin * i / period);
+        }
+        return signal;
+    }
+
+    // passband up to 0.45 of the base rate within 0.005 dB, the images of the upsampling above
+    // 0.55 of it at least 70 dB down, see SF_OVERSAMPLER_STAGE0TAPS
+    void expectUpsampling(int factor)
+    {
+        for (double frequency : { 0.01, 0.1, 0.2, 0.3, 0.4, 0.45 })
+        {
+            int bin = (int)(frequency * length);
+            std::vector<float> input = sine(settle + length, bin, length);
+            std::vector<float> output((size_t)((settle + length) * factor));
+            Oversampler oversampler;
+            oversampler.prepare(1, false);
+            oversampler.set_factor(factor);
+            for (int pos = 0; pos < settle + length; pos += SF_OVERSAMPLER_MAXBLOCK)
+            {
+                oversampler.upsample(0, input.data() + pos, output.data() + pos * factor, SF_OVERSAMPLER_MAXBLOCK);
+            }
+            size_t start = (size_t)(settle * factor);
+            double gain = amplitude(output, start, length * factor, bin);
+            expectLessThan(std::abs(20.0 * std::log10(gain)), 0.005,
+                "passband deviation in dB at " + juce::String(frequency) + " of the sample rate");
+            double image = 0.0;
+            for (int k = 1; k < factor; k++)
+            {
+                image = juce::jmax(image, amplitude(output, start, length * factor, k * length - bin));
+                image = juce::jmax(image, amplitude(output, start, length * factor, k * length + bin));
+            }
+            expectLessThan(20.0 * std::log10(image), -70.0,
+                "largest image in dB at " + juce::String(frequency) + " of the sample rate");
+        }
+    }
+
+    // the passband as above, and whatever would alias into it from above 0.55 of the base rate at
+    // least 70 dB down
+    void expectDownsampling(int factor)
+    {
+        for (double frequency : { 0.01, 0.1, 0.2, 0.3, 0.4, 0.45, 0.55, 0.7, 0.9, 1.3, 2.2, 3.7 })
+        {
+            if (frequency >= 0.5 * factor)
+                continue;
+            int bin = (int)(frequency * length);
+            std::vector<float> input = sine((settle + length) * factor, bin, length * factor);
+            std::vector<float> output((size_t)(settle + length));
+            Oversampler oversampler;
+            oversampler.prepare(1);
+            oversampler.set_factor(factor);
+            for (int pos = 0; pos < settle + length; pos += SF_OVERSAMPLER_MAXBLOCK)
+            {
+                oversampler.downsample(0, input.data() + pos * factor, output.data() + pos, SF_OVERSAMPLER_MAXBLOCK);
+            }
+            // the bin the sine lands on at the base rate
+            int alias = bin % length;
+            if (alias > length / 2)
+                alias = length - alias;
+            double level = 20.0 * std::log10(amplitude(output, (size_t)settle, length, alias));
+            if (frequency < 0.5)
+                expectLessThan(std::abs(level), 0.005, "passband deviation in dB at " + juce::String(frequency) + " of the sample rate");
+            else
+                expectLessThan(level, -70.0, "alias in dB from " + juce::String(frequency) + " of the sample rate");
+        }
+    }
+};
+
+static OversamplerTest oversamplerTest;
@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    RenderTests.cpp
+    Created: 17 Oct 2026 11:48:20pm
+    Author:  marks
+
+    Unit tests for the offline renderers.
+
+  ==============================================================================
+*/
+
+#include "../Render/OfflineRenderer.h"
+#include "../Render/SegmentedRenderer.h"
+#include "../Render/WorkStealingPool.h"
+#include <cmath>
+#include <cstring>
+
+class SegmentedRenderTest : public juce::UnitTest
+{
+public:
+
+    SegmentedRenderTest() : juce::UnitTest("Segmented render", "Render") {}
+
+    void runTest() override
+    {
+        const int samplerate = 48000;
+        juce::TemporaryFile input(".wav");
+        beginTest("Write the test signal");
+        expect(writeSignal(input.getFile(), samplerate * 20, samplerate), "cannot write the input");
+
+        RenderSettings settings;
+        settings.threshold = -30.0f;
+        settings.blocksize = 4096;
+        settings.warmup = 2.0f;
+        settings.seamwindow = 1.0f;
+
+        beginTest("Peak detector");
+        expectSameRender(input.getFile(), settings);
+
+        // a window that is no whole number of chunks, so the window and the chunks start over on
+        // different samples
+        beginTest("RMS detector");
+        settings.rmswindow = 0.0437f;
+        expectSameRender(input.getFile(), settings);
+    }
+
+private:
+
+    // stereo noise under an envelope that swings over 40 dB three times a second, as 32 bit float
+    static bool writeSignal(const juce::File& file, int numsamples, int samplerate)
+    {
+        juce::String error;
+        std::unique_ptr<juce::AudioFormatWriter> writer = OfflineRenderer::createWriter(file, samplerate, 2, 32, error);
+        if (writer == nullptr)
+            return false;
+        juce::Random random(1234);
+        juce::AudioBuffer<float> buffer(2, numsamples);
+        for (int i = 0; i < numsamples; i++)
+        {
+            float envelope = 0.01f + 0.99f * std::pow(0.5f + 0.5f * std::sin(6.0f * (float)M_PI * (float)i / (float)samplerate), 4.0f);
+            buffer.getWritePointer(0)[i] = envelope * (2.0f * random.nextFloat() - 1.0f);
+            buffer.getWritePointer(1)[i] = envelope * (2.0f * random.nextFloat() - 1.0f);
+        }
+        return writer->writeFromAudioSampleBuffer(buffer, 0, numsamples);
+    }
+
+    static bool readFile(const juce::File& file, juce::AudioBuffer<float>& buffer)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader = OfflineRenderer::createReader(file);
+        if (reader == nullptr)
+            return false;
+        buffer.setSize((int)reader->numChannels, (int)reader->lengthInSamples);
+        return reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+    }
+
+    // with a warm-up long enough for the envelope to converge, every segment joins the one before it
+    // exactly, and the segmented render is the sequential one bit for bit
+    void expectSameRender(const juce::File& input, RenderSettings settings)
+    {
+        juce::TemporaryFile sequential(".wav");
+        juce::TemporaryFile segmented(".wav");
+        juce::String error;
+        settings.segments = 1;
+        OfflineRenderer single(settings);
+        expect(single.render(input, sequential.getFile(), error), error);
+
+        settings.segments = 4;
+        SegmentedRenderer parallel(settings);
+        WorkStealingPool pool(4);
+        expect(parallel.render(input, segmented.getFile(), pool, error), error);
+        expectEquals((int)parallel.getSeams().size(), 3, "seams");
+        for (const SegmentedRenderer::Seam& seam : parallel.getSeams())
+        {
+            expect(seam.exact, "seam at " + juce::String((int)seam.position) + " is not exact");
+        }
+
+        juce::AudioBuffer<float> a, b;
+        expect(readFile(sequential.getFile(), a) && readFile(segmented.getFile(), b), "cannot read the renders");
+        expectEquals(b.getNumChannels(), a.getNumChannels(), "channels");
+        expectEquals(b.getNumSamples(), a.getNumSamples(), "length");
+        if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() != b.getNumSamples())
+            return;
+        for (int ch = 0; ch < a.getNumChannels(); ch++)
+        {
+            expect(memcmp(a.getReadPointer(ch), b.getReadPointer(ch), (size_t)a.getNumSamples() * sizeof(float)) == 0,
+                "channel " + juce::String(ch) + " differs");
+        }
+    }
+};
+
+static SegmentedRenderTest segmentedRenderTest;